@@ -0,0 +1,117 @@
+#include "BlockIndex.h"
+#include <cstdio>
+#include <cstring>
+
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+static const char index_magic[4] = {'C', '8', 'B', 'I'};
+
+// integers are stored as little endian base 128 varints, block starts as
+// the distance from the previous block so nearly all of them take a byte
+static void writeVarint(std::FILE *file, uint64_t value) {
+  while (value >= 0x80) {
+    std::fputc((value & 0x7F) | 0x80, file);
+    value >>= 7;
+  }
+  std::fputc(value, file);
+}
+
+static bool readVarint(std::FILE *file, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = std::fgetc(file);
+    if (byte == EOF) {
+      return false;
+    }
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+BlockIndex::BlockIndex(void) {
+  this->rom_size = 0;
+  this->rom_hash = 0;
+}
+
+uint64_t BlockIndex::hashRom(const uint8_t *rom, int size) {
+  uint64_t hash = FNV_OFFSET;
+  for (int i = 0; i < size; i++) {
+    hash = (hash ^ rom[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+bool BlockIndex::matches(const uint8_t *rom, int size) {
+  return this->rom_size == (uint32_t)size && this->rom_hash == hashRom(rom, size);
+}
+
+bool BlockIndex::save(const char *name) {
+  std::FILE *file = std::fopen(name, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  std::fwrite(index_magic, 1, sizeof(index_magic), file);
+  writeVarint(file, BLOCK_INDEX_VERSION);
+  writeVarint(file, this->rom_size);
+  writeVarint(file, this->rom_hash);
+  writeVarint(file, this->blocks.size());
+  uint16_t start = 0;
+  for (const Block &block : this->blocks) {
+    writeVarint(file, block.start - start);
+    writeVarint(file, block.length);
+    writeVarint(file, block.successors.size());
+    for (uint16_t successor : block.successors) {
+      writeVarint(file, successor);
+    }
+    start = block.start;
+  }
+  bool written = !std::ferror(file);
+  written &= std::fclose(file) == 0;
+  return written;
+}
+
+bool BlockIndex::load(const char *name) {
+  std::FILE *file = std::fopen(name, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  // parsed into locals, a truncated or corrupt index leaves this one empty
+  char magic[4];
+  uint64_t version = 0, rom_size = 0, rom_hash = 0, count = 0;
+  bool valid = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+               std::memcmp(magic, index_magic, sizeof(magic)) == 0 &&
+               readVarint(file, version) && version == BLOCK_INDEX_VERSION &&
+               readVarint(file, rom_size) && readVarint(file, rom_hash) &&
+               readVarint(file, count);
+  std::vector<Block> blocks;
+  uint64_t start = 0;
+  for (uint64_t i = 0; valid && i < count; i++) {
+    uint64_t delta, length, successors, successor;
+    if (!readVarint(file, delta) || !readVarint(file, length) || !readVarint(file, successors)) {
+      valid = false;
+      break;
+    }
+    start += delta;
+    Block block;
+    block.start = start;
+    block.length = length;
+    for (uint64_t j = 0; valid && j < successors; j++) {
+      valid = readVarint(file, successor);
+      block.successors.push_back(successor);
+    }
+    blocks.push_back(block);
+  }
+  std::fclose(file);
+  this->blocks.clear();
+  if (!valid) {
+    return false;
+  }
+  this->rom_size = rom_size;
+  this->rom_hash = rom_hash;
+  this->blocks.swap(blocks);
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef __BLOCK_INDEX_
+#define __BLOCK_INDEX_
+
+#include <stdint.h>
+#include <vector>
+
+#define BLOCK_INDEX_VERSION 1
+
+// The basic blocks reachable from 0x200 by following jumps, calls and
+// skips, as found by chip8dasm --flow and saved next to the ROM. Loading
+// the ROM decodes, and with the JIT also translates, every indexed block
+// up front. The ROM's size and hash tie an index to the ROM it describes.
+class BlockIndex {
+  public:
+    struct Block {
+      uint16_t start;
+      uint16_t length; // in instructions
+      std::vector<uint16_t> successors;
+    };
+    BlockIndex(void);
+    uint32_t rom_size;
+    uint64_t rom_hash;
+    std::vector<Block> blocks; // sorted by start
+    static uint64_t hashRom(const uint8_t *rom, int size);
+    bool matches(const uint8_t *rom, int size);
+    bool save(const char *name);
+    bool load(const char *name);
+};
+
+#endif // __BLOCK_INDEX_
\ No newline at end of file
@@ -1,20 +1,36 @@
 #include "CPU.h"
+#include "JIT.h"
+#include "Frontend.h"
+#include "FrameBuffer.h"
+#include "Rewind.h"
+#include "InputLog.h"
 #include <cstring>
 #include <cstdio>
-#include <unistd.h>
+#include <string>
+#include <time.h>
 #include <ctime>
 #include <cstdlib>
 #include <stdarg.h>
-#include <ncurses.h>
+#include <thread>
+#include <algorithm>
 
-#define MS 1000
-#define SEC (MS * 1000)
+#define NSEC 1000000000L
 #define DEBUG 0
-#define CYCLES_PER_SECOND 500
+// cycles run between clock checks in turbo mode
+#define TURBO_BATCH_CYCLES 10000
+// how far behind the clock may fall before it is resynchronized
+#define MAX_LAG_FRAMES 15
+// memory is compared in chunks of this many bytes when restoring a state
+#define STATE_COMPARE_CHUNK 64
+
+static const char state_magic[4] = {'C', '8', 'S', 'T'};
+
+struct StateFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t size;
+};
 
-#define WHITE_COLOR 1
-#define BLACK_COLOR 2
-#define CHANGE_COLOR(COLOR) attron(COLOR_PAIR(COLOR))
 
 static void log(const char *format, ...) {
   #if DEBUG == 1
@@ -26,12 +42,11 @@ static void log(const char *format, ...) {
   #endif
 }
 
-static const char keyboard[] = {
-  '1', '2', '3', '4',
-  'q', 'w', 'e', 'r',
-  'a', 's', 'd', 'f',
-  'z', 'x', 'c', 'v'
-};
+static const StaticProgram *registered_program = NULL;
+
+void registerStaticProgram(const StaticProgram *program) {
+  registered_program = program;
+}
 
 const static uint8_t fontset[] = { 
   0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -52,122 +67,504 @@ const static uint8_t fontset[] = {
   0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-void Chip8::checkInput(void) {
-  log("Key = %d\n", pressed_key);
-  if (pressed_key == ERR) {
-    this->clearKeys();
-    return;
-  }
-  for (int i = 0; i < sizeof(keyboard); i++) {
-    if (keyboard[i] == pressed_key) {
-      this->clearKeys();
-      this->setKey(i);
-      break;
-    }
-  }
-}
-
 void Chip8::drawScreen(void) {
-  for (int y = 0; y < SCREEN_HEIGHT; y++) {
-    for (int x = 0; x < SCREEN_WIDTH; x++) {
-      if (this->screen[(y * SCREEN_WIDTH) + x] == 0) {
-        CHANGE_COLOR(BLACK_COLOR);
-        mvprintw(y, x * 2, "  ");
-      } else {
-        CHANGE_COLOR(WHITE_COLOR);
-        mvprintw(y, x * 2, "  ");
-      }
-    }
-  }
-  refresh();
+  this->frontend->drawScreen(this->screen);
   this->should_draw = false;
 }
 
-Chip8::Chip8(void) {
+static NullFrontend null_frontend;
+
+Chip8::Chip8(Frontend *frontend) {
+  this->frontend = frontend != NULL ? frontend : &null_frontend;
+  this->jit = NULL;
+  this->frames = NULL;
+  this->rewind = NULL;
+  this->input_log = NULL;
+  this->live_keys = 0;
+  this->rendering = false;
+  this->sound_on = false;
+  this->static_program = NULL;
+  this->reference_dispatch = false;
+  this->cycles_per_second = DEFAULT_CYCLES_PER_SECOND;
+  this->turbo = false;
+  this->setTimerMode(TIMER_VIRTUAL);
+  this->quirks = QUIRKS_MODERN;
+  this->dispatch = &tables[QUIRKS_MODERN];
+  this->reference_decoder = &Chip8::referenceOpcode<QUIRKS_MODERN>;
+  this->seedRandom(std::time(0));
+  this->reset();
+}
+
+void Chip8::reset(void) {
+  this->cycle_count = 0;
+  this->jit_budget = 0;
+  this->idle_loop = false;
+  this->idle = false;
   this->delay_timer = 0;
   this->sound_timer = 0;
   this->program_counter = 0x200;
   this->current_opcode = 0;
   this->index_register = 0;
   this->stack_ptr = 0;
-  this->timer_counter = 0;
+  this->timer_phase = 0;
   this->game_finished = false;
   this->should_draw = false;
   this->clearKeys();
   std::memset(this->memory, 0, MEM_SIZE);
   std::memset(this->registers, 0, REGISTER_COUNT);
   std::memset(this->stack, 0, STACK_SIZE * sizeof(uint16_t));
-  std::memset(this->screen, 0, SCREEN_WIDTH * SCREEN_HEIGHT);
-  std::srand(std::time(0));
+  std::memset(this->screen, 0, sizeof(this->screen));
   for (int i = 0; i < 80; i++) {
     this->memory[i] = fontset[i];
   }
-  initscr();
-  cbreak();
-  noecho();
-  start_color();
-  init_pair(WHITE_COLOR, COLOR_BLACK, COLOR_WHITE);
-  init_pair(BLACK_COLOR, COLOR_WHITE, COLOR_BLACK);
-  timeout(0);
+  this->static_program = NULL;
+  this->block_index.blocks.clear();
+  this->invalidateDecoded(0, MEM_SIZE);
 }
 
 void Chip8::executeCycle(void) {
-  // Fetch the next opcode
-  uint8_t first_byte = this->memory[this->program_counter];
-  uint8_t second_byte = this->memory[this->program_counter + 1];
-  this->current_opcode = (first_byte << 8) | second_byte;
+  #if PROFILE
+    uint16_t address = this->program_counter & 0xFFF;
+  #endif
+  if (this->reference_dispatch) {
+    // Fetch the next opcode
+    // wrapped around the end of memory like executeDecoded, so the two
+    // paths agree at 0xFFF
+    this->program_counter &= 0xFFF;
+    uint8_t first_byte = this->memory[this->program_counter];
+    uint8_t second_byte = this->memory[(this->program_counter + 1) & 0xFFF];
+    this->current_opcode = (first_byte << 8) | second_byte;
+    this->executeOpcodeReference();
+  } else {
+    this->executeDecoded();
+  }
+  #if PROFILE
+    this->profile.count(address, this->current_opcode, this->program_counter == address);
+  #endif
+  this->updateTimers();
+}
+
+void Chip8::executeDecoded(void) {
+  // Fetch the pre-decoded instruction, decoding it on first use
+  uint16_t address = this->program_counter & 0xFFF;
+  if (address != this->program_counter) {
+    // wrap around the end of memory
+    this->program_counter = address;
+  }
+  Instruction &ins = this->decoded[address];
+  if (ins.handler == NULL) {
+    this->decodeAt(address);
+  }
+  this->current_opcode = ins.opcode;
+  (this->*ins.handler)(ins);
+}
+
+bool Chip8::isDelayLoop(uint16_t jump_address) {
+  // FX07, 3XNN, 1NNN back to the FX07, spinning until the delay timer
+  // reaches NN
+  if (jump_address < 4 || jump_address > MEM_SIZE - 2) {
+    return false;
+  }
+  uint16_t start = jump_address - 4;
+  uint16_t read = (this->memory[start] << 8) | this->memory[start + 1];
+  uint16_t test = (this->memory[start + 2] << 8) | this->memory[start + 3];
+  uint16_t jump = (this->memory[jump_address] << 8) | this->memory[jump_address + 1];
+  return jump == (0x1000 | start) && (read & 0xF0FF) == 0xF007 &&
+         (test & 0xFF00) == (0x3000 | (read & 0x0F00));
+}
+
+uint32_t Chip8::skipIdleCycles(uint32_t max_cycles) {
+  this->idle_loop = false;
+  uint16_t address = this->program_counter & 0xFFF;
+  uint16_t opcode = (this->memory[address] << 8) | this->memory[(address + 1) & 0xFFF];
+  if ((opcode & 0xF0FF) == 0xF00A) {
+    if (this->getKey() != -1) {
+      return 0;
+    }
+    // the key state is sampled again at the next batch
+    #if PROFILE
+      this->profile.count(address, opcode, true, max_cycles);
+    #endif
+    this->advanceTimers(max_cycles);
+    this->idle = true;
+    return max_cycles;
+  }
+  // the loop code may have been rewritten since the jump was decoded
+  if (!this->isDelayLoop(address + 4)) {
+    return 0;
+  }
+  uint8_t register_index = (opcode & 0x0F00) >> 8;
+  uint8_t target = this->memory[address + 3];
+  uint32_t iterations = max_cycles / 3;
+  bool endless = true;
+  if (this->timer_step != 0 && this->delay_timer >= target) {
+    if (this->delay_timer == target) {
+      return 0;
+    }
+    // the timer reaches the target at the end of this cycle, and the
+    // first FX07 that runs after it ends the loop
+    uint64_t ticks = this->delay_timer - target;
+    uint64_t cycles = (ticks * this->cycles_per_second - this->timer_phase + this->timer_step - 1) / this->timer_step;
+    uint64_t needed = (cycles + 2) / 3;
+    if (needed <= iterations) {
+      iterations = needed;
+      endless = false;
+    }
+  }
+  if (iterations == 0) {
+    return 0;
+  }
+  #if PROFILE
+    for (int i = 0; i < 3; i++) {
+      uint16_t step = address + 2 * i;
+      this->profile.count(step, (this->memory[step] << 8) | this->memory[step + 1], false, iterations);
+    }
+  #endif
+  // every skipped iteration only copies the delay timer into VX
+  this->advanceTimers(3 * (iterations - 1));
+  this->registers[register_index] = this->delay_timer;
+  this->advanceTimers(3);
+  this->idle = endless;
+  return 3 * iterations;
+}
+
+void Chip8::tickTimers(void) {
+  if (this->delay_timer > 0) {
+    this->delay_timer--;
+  }
+  if (this->sound_timer > 0) {
+    this->sound_timer--;
+  }
+}
+
+void Chip8::updateTimers(void) {
+  // every cycle is 1 / cycles_per_second of emulated time, so the timers
+  // tick each time 60 / cycles_per_second adds up to a whole
+  this->timer_phase += this->timer_step;
+  // clocks below 60 Hz tick more than once per cycle
+  while (this->timer_phase >= this->cycles_per_second) {
+    this->timer_phase -= this->cycles_per_second;
+    this->tickTimers();
+  }
+}
+
+void Chip8::advanceTimers(uint32_t cycles) {
+  // same as calling updateTimers once per cycle
+  uint64_t phase = this->timer_phase + (uint64_t)this->timer_step * cycles;
+  uint64_t ticks = phase / this->cycles_per_second;
+  this->timer_phase = phase % this->cycles_per_second;
+  if (ticks > 0) {
+    this->delay_timer = this->delay_timer > ticks ? this->delay_timer - ticks : 0;
+    this->sound_timer = this->sound_timer > ticks ? this->sound_timer - ticks : 0;
+  }
+}
+
+uint32_t Chip8::cyclesUntilTimerTick(void) {
+  if (this->timer_step == 0) {
+    return UINT32_MAX;
+  }
+  // the tick happens at the end of the returned cycle
+  uint32_t missing = this->cycles_per_second - this->timer_phase;
+  return (missing + this->timer_step - 1) / this->timer_step;
+}
+
+void Chip8::setTimerMode(int mode) {
+  this->timer_mode = mode;
+  this->timer_step = mode == TIMER_VIRTUAL ? TIMER_FREQUENCY : 0;
+}
+
+void Chip8::setQuirks(int profile) {
+  if (profile < 0 || profile >= QUIRKS_COUNT || profile == this->quirks) {
+    return;
+  }
+  static void (Chip8::*const reference_decoders[QUIRKS_COUNT])(void) = {
+    &Chip8::referenceOpcode<QUIRKS_MODERN>, &Chip8::referenceOpcode<QUIRKS_VIP>,
+    &Chip8::referenceOpcode<QUIRKS_CHIP48>, &Chip8::referenceOpcode<QUIRKS_SCHIP>
+  };
+  this->quirks = profile;
+  this->dispatch = &tables[profile];
+  this->reference_decoder = reference_decoders[profile];
+  // everything decoded so far points into the old profile's handlers
+  for (int i = 0; i < MEM_SIZE; i++) {
+    this->decoded[i].handler = NULL;
+  }
+  if (this->jit != NULL) {
+    this->jit->flush();
+  }
+  if (this->static_program != NULL && this->static_program->quirks != profile) {
+    log("Static code built for another profile, falling back to the interpreter\n");
+    this->static_program = NULL;
+  }
+  this->warmBlocks();
+}
+
+uint32_t Chip8::runCycles(uint32_t count) {
+  if (this->static_program == NULL && this->jit != NULL && !this->reference_dispatch) {
+    uint32_t executed = this->jit->run(count);
+    this->cycle_count += executed;
+    return executed;
+  }
+  uint32_t executed = 0;
+  while (executed < count && !this->game_finished) {
+    uint32_t ran = 0;
+    if (this->static_program != NULL && !this->reference_dispatch) {
+      ran = this->static_program->run_block(this, count - executed, this->cyclesUntilTimerTick());
+      this->advanceTimers(ran);
+    }
+    if (ran == 0) {
+      this->executeCycle();
+      ran = 1;
+    }
+    executed += ran;
+    if (this->idle_loop) {
+      executed += this->skipIdleCycles(count - executed);
+    }
+    if (this->should_draw) {
+      break;
+    }
+  }
+  this->cycle_count += executed;
+  return executed;
+}
+
+void Chip8::enableJit(bool enabled) {
+  #if PROFILE
+    // translated code runs past the counters
+    log("Profiling build, staying on the interpreter\n");
+    enabled = false;
+  #endif
+  if (enabled && this->jit == NULL) {
+    this->jit = new Jit(this);
+    if (!this->jit->isAvailable()) {
+      log("JIT unavailable, falling back to the interpreter\n");
+      delete this->jit;
+      this->jit = NULL;
+    } else {
+      this->warmBlocks();
+    }
+  } else if (!enabled && this->jit != NULL) {
+    delete this->jit;
+    this->jit = NULL;
+  }
+}
+
+bool Chip8::writeProfile(std::FILE *out) {
+  #if PROFILE
+    this->profile.write(out, this->memory);
+    return true;
+  #else
+    (void)out;
+    return false;
+  #endif
+}
+
+void Chip8::enableRewind(bool enabled) {
+  if (enabled && this->rewind == NULL) {
+    this->rewind = new Rewind();
+  } else if (!enabled && this->rewind != NULL) {
+    delete this->rewind;
+    this->rewind = NULL;
+  }
+}
 
-  // Execute it
-  this->executeOpcode();
-  if (this->timer_counter == 0) {
-    // update timers at 60Hz
-    if (this->delay_timer > 0) {
-      this->delay_timer--;
+void Chip8::seedRandom(uint32_t seed) {
+  // xorshift never leaves zero
+  this->random_state = seed != 0 ? seed : 0x6D2B79F5;
+}
+
+void Chip8::recordInput(InputLog *log) {
+  this->input_log = log;
+  if (log != NULL) {
+    this->cycle_count = 0;
+    log->seed = this->random_state;
+    log->cycles_per_second = this->cycles_per_second;
+    log->timer_mode = this->timer_mode;
+    log->quirks = this->quirks;
+    log->events.clear();
+    log->addKeys(this->cycle_count, this->keys.load(std::memory_order_relaxed));
+  }
+}
+
+uint64_t Chip8::replayInput(const InputLog &log, uint64_t max_cycles) {
+  this->seedRandom(log.seed);
+  this->setClockSpeed(log.cycles_per_second);
+  this->setTimerMode(log.timer_mode);
+  this->setQuirks(log.quirks);
+  this->cycle_count = 0;
+  size_t next = 0;
+  while (true) {
+    // events logged at the final cycle still apply, the session ended
+    // with a timer tick
+    while (next < log.events.size() && log.events[next].cycle <= this->cycle_count) {
+      if (log.events[next].type == INPUT_EVENT_KEYS) {
+        this->keys.store(log.events[next].keys, std::memory_order_relaxed);
+      } else {
+        this->tickTimers();
+      }
+      next++;
+    }
+    if (this->cycle_count >= max_cycles || this->game_finished) {
+      break;
     }
-    if (this->sound_timer > 0) {
-      beep();
-      this->sound_timer--;
+    uint64_t batch = max_cycles - this->cycle_count;
+    if (next < log.events.size()) {
+      batch = std::min(batch, log.events[next].cycle - this->cycle_count);
     }
+    this->runCycles(std::min(batch, (uint64_t)UINT32_MAX));
+    this->should_draw = false;
   }
-  this->timer_counter = (this->timer_counter + 1) % 10;
+  return this->cycle_count;
+}
+
+Chip8::~Chip8(void) {
+  delete this->jit;
+  delete this->rewind;
 }
 
 void Chip8::setKey(uint8_t index) {
-  this->keys[index] = 1;
+  this->keys.fetch_or(1 << index, std::memory_order_relaxed);
 }
 
 void Chip8::clearKeys(void) {
-  std::memset(this->keys, 0, KEYS_COUNT);
+  this->keys.store(0, std::memory_order_relaxed);
 }
 
 int8_t Chip8::getKey(void) {
-  for (int i = 0; i < KEYS_COUNT; i++) {
-    if (this->keys[i]) {
-      return i;
+  uint16_t pressed = this->keys.load(std::memory_order_relaxed);
+  if (pressed == 0) {
+    return -1;
+  }
+  return __builtin_ctz(pressed);
+}
+
+static void addNanoseconds(struct timespec &time, long nanoseconds) {
+  time.tv_nsec += nanoseconds;
+  while (time.tv_nsec >= NSEC) {
+    time.tv_nsec -= NSEC;
+    time.tv_sec++;
+  }
+}
+
+static long nanosecondsBetween(const struct timespec &from, const struct timespec &to) {
+  return (to.tv_sec - from.tv_sec) * NSEC + (to.tv_nsec - from.tv_nsec);
+}
+
+void Chip8::setClockSpeed(uint32_t cycles_per_second) {
+  this->cycles_per_second = cycles_per_second > 0 ? cycles_per_second : 1;
+  this->timer_phase %= this->cycles_per_second;
+}
+
+void Chip8::setTurbo(bool turbo) {
+  this->turbo = turbo;
+}
+
+bool Chip8::runFrameCycles(uint32_t count) {
+  bool frame_ready = false;
+  while (count > 0 && !this->game_finished) {
+    count -= this->runCycles(count);
+    if (this->should_draw) {
+      // only the final frame gets presented
+      frame_ready = true;
+      this->should_draw = false;
     }
   }
-  return -1;
+  return frame_ready;
+}
+
+void Chip8::renderFrames(void) {
+  // presents the newest published frame once per display refresh, a slow
+  // frontend only delays this thread
+  const long frame_time = NSEC / FRAMES_PER_SECOND;
+  struct timespec deadline;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  while (this->rendering) {
+    const uint64_t *frame = this->frames->acquire();
+    if (frame != NULL) {
+      this->frontend->drawScreen(frame);
+    }
+    this->frontend->setSound(this->sound_on);
+    addNanoseconds(deadline, frame_time);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (nanosecondsBetween(deadline, now) > MAX_LAG_FRAMES * frame_time) {
+      deadline = now;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+  }
+  this->frontend->setSound(false);
 }
 
 void Chip8::runEmu(void) {
-  int ERRs = 0;
+  const long frame_time = NSEC / FRAMES_PER_SECOND;
+  struct timespec deadline;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  uint32_t cycle_remainder = 0;
+  bool frame_ready = false;
+  this->frontend->startInput(this->input_log != NULL ? &this->live_keys : &this->keys);
+  this->frames = new FrameBuffer();
+  this->rendering = true;
+  std::thread renderer(&Chip8::renderFrames, this);
   while (!this->game_finished) {
-    int key = getch();
-    if (key == ERR) {
-      ERRs++;
+    addNanoseconds(deadline, frame_time);
+    this->idle = false;
+    if (this->input_log != NULL) {
+      // while recording, keys only change between frames so the change
+      // lands on a known cycle
+      uint16_t keys = this->live_keys.load(std::memory_order_relaxed);
+      if (keys != this->keys.load(std::memory_order_relaxed)) {
+        this->keys.store(keys, std::memory_order_relaxed);
+        this->input_log->addKeys(this->cycle_count, keys);
+      }
+    }
+    Chip8State previous;
+    bool rewound = this->rewind != NULL && this->input_log == NULL && this->frontend->rewindHeld() &&
+                   this->rewind->stepBack(previous);
+    if (rewound) {
+      // one recorded frame back per frame while the key is held
+      this->loadState(previous);
+      frame_ready = true;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+    } else if (this->turbo) {
+      // turbo, run as many cycles as fit in the frame unless the game
+      // only waits for input or the next frame
+      do {
+        frame_ready |= this->runFrameCycles(TURBO_BATCH_CYCLES);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+      } while (!this->game_finished && !this->idle && nanosecondsBetween(now, deadline) > 0);
     } else {
-      ERRs = 0;
-      pressed_key = key;
+      cycle_remainder += this->cycles_per_second;
+      frame_ready |= this->runFrameCycles(cycle_remainder / FRAMES_PER_SECOND);
+      cycle_remainder %= FRAMES_PER_SECOND;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    if (this->timer_mode == TIMER_WALLCLOCK && !rewound) {
+      this->tickTimers();
+      if (this->input_log != NULL) {
+        this->input_log->addTimerTick(this->cycle_count);
+      }
     }
-    if (ERRs == 10) {
-      pressed_key = ERR;
+    if (this->rewind != NULL && !rewound) {
+      this->rewind->record(*this);
     }
-    if (this->should_draw) {
-      this->drawScreen();
+    if (frame_ready) {
+      this->frames->publish(this->screen);
+      frame_ready = false;
+    }
+    this->sound_on = this->sound_timer > 0;
+    if (nanosecondsBetween(deadline, now) > MAX_LAG_FRAMES * frame_time) {
+      // the host can't keep up, drop the missed frames
+      deadline = now;
     }
-    this->checkInput();
-    this->executeCycle();
-    usleep(SEC / CYCLES_PER_SECOND); // 500Hz
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+  }
+  this->rendering = false;
+  renderer.join();
+  delete this->frames;
+  this->frames = NULL;
+  this->frontend->stopInput();
+  if (this->input_log != NULL) {
+    this->input_log->end_cycle = this->cycle_count;
   }
 }
 
@@ -195,14 +592,631 @@ bool Chip8::loadGame(const char *name) {
     return false;
   }
   std::fclose(game_file);
-  for (int i = 0; i < size; i++) {
-    this->memory[INTERPRETER_SIZE + i] = game_buffer[i];
+  this->loadGame(game_buffer, size);
+  std::string index_name = std::string(name).substr(0, std::string(name).rfind(".")) + ".blocks";
+  if (this->block_index.load(index_name.c_str()) && this->block_index.matches(game_buffer, size)) {
+    log("Warming %zu indexed blocks\n", this->block_index.blocks.size());
+    this->warmBlocks();
+  } else {
+    this->block_index.blocks.clear();
   }
   log("Game loaded to memory\n");
   return true;
 }
 
+bool Chip8::loadGame(const uint8_t *rom, int size) {
+  if (size < 0 || size > MAX_ROM_SIZE) {
+    log("ROM exceeds maximum size\n");
+    return false;
+  }
+  std::memcpy(this->memory + INTERPRETER_SIZE, rom, size);
+  this->invalidateDecoded(INTERPRETER_SIZE, size);
+  // an index only comes with a ROM file
+  this->block_index.blocks.clear();
+  const StaticProgram *program = registered_program;
+  if (program != NULL && program->rom_size == size && program->quirks == this->quirks && !PROFILE &&
+      std::memcmp(program->rom, rom, size) == 0) {
+    log("Using statically recompiled code\n");
+    this->static_program = program;
+  }
+  return true;
+}
+
+void Chip8::saveState(Chip8State &state) {
+  state = *this;
+}
+
+void Chip8::loadState(const Chip8State &state) {
+  for (int i = 0; i < MEM_SIZE; i += STATE_COMPARE_CHUNK) {
+    if (std::memcmp(this->memory + i, state.memory + i, STATE_COMPARE_CHUNK) != 0) {
+      this->invalidateDecoded(i, STATE_COMPARE_CHUNK);
+    }
+  }
+  static_cast<Chip8State &>(*this) = state;
+  this->timer_phase %= this->cycles_per_second;
+  this->game_finished = false;
+  this->should_draw = true;
+}
+
+bool Chip8::saveStateFile(const char *name) {
+  std::FILE *state_file = std::fopen(name, "wb");
+  if (state_file == NULL) {
+    log("Couldn't open %s!\n", name);
+    return false;
+  }
+  StateFileHeader header;
+  std::memcpy(header.magic, state_magic, sizeof(state_magic));
+  header.version = STATE_VERSION;
+  header.size = sizeof(Chip8State);
+  const Chip8State &state = *this;
+  bool written = std::fwrite(&header, sizeof(header), 1, state_file) == 1 &&
+                 std::fwrite(&state, sizeof(state), 1, state_file) == 1;
+  written &= std::fclose(state_file) == 0;
+  if (!written) {
+    log("Error writing %s\n", name);
+  }
+  return written;
+}
+
+bool Chip8::loadStateFile(const char *name) {
+  std::FILE *state_file = std::fopen(name, "rb");
+  if (state_file == NULL) {
+    log("Couldn't open %s!\n", name);
+    return false;
+  }
+  StateFileHeader header;
+  Chip8State state;
+  bool valid = std::fread(&header, sizeof(header), 1, state_file) == 1 &&
+               std::memcmp(header.magic, state_magic, sizeof(state_magic)) == 0 &&
+               header.version == STATE_VERSION && header.size == sizeof(Chip8State) &&
+               std::fread(&state, sizeof(state), 1, state_file) == 1;
+  std::fclose(state_file);
+  if (!valid) {
+    log("%s is not a savestate of this version\n", name);
+    return false;
+  }
+  this->loadState(state);
+  return true;
+}
+
+Chip8::DispatchTables::DispatchTables(int quirks) {
+  for (int i = 0; i < 256; i++) {
+    this->key[i] = &Chip8::opUnknown;
+    this->misc[i] = &Chip8::opUnknown;
+  }
+  for (int i = 0; i < 16; i++) {
+    this->alu[i] = &Chip8::opUnknown;
+  }
+  this->main[0x0] = &Chip8::op0Group;
+  this->main[0x1] = &Chip8::op1NNN;
+  this->main[0x2] = &Chip8::op2NNN;
+  this->main[0x3] = &Chip8::op3XNN;
+  this->main[0x4] = &Chip8::op4XNN;
+  this->main[0x5] = &Chip8::op5XY0;
+  this->main[0x6] = &Chip8::op6XNN;
+  this->main[0x7] = &Chip8::op7XNN;
+  // 0x8, 0xE and 0xF are resolved through their second-level tables
+  this->main[0x8] = &Chip8::opUnknown;
+  this->main[0x9] = &Chip8::op9XY0;
+  this->main[0xA] = &Chip8::opANNN;
+  this->main[0xB] = &Chip8::opBNNN;
+  this->main[0xC] = &Chip8::opCXNN;
+  this->main[0xE] = &Chip8::opUnknown;
+  this->main[0xF] = &Chip8::opUnknown;
+  this->alu[0x0] = &Chip8::op8XY0;
+  this->alu[0x1] = &Chip8::op8XY1;
+  this->alu[0x2] = &Chip8::op8XY2;
+  this->alu[0x3] = &Chip8::op8XY3;
+  this->alu[0x4] = &Chip8::op8XY4;
+  this->alu[0x5] = &Chip8::op8XY5;
+  this->alu[0x7] = &Chip8::op8XY7;
+  this->key[0x9E] = &Chip8::opEX9E;
+  this->key[0xA1] = &Chip8::opEXA1;
+  this->misc[0x07] = &Chip8::opFX07;
+  this->misc[0x0A] = &Chip8::opFX0A;
+  this->misc[0x15] = &Chip8::opFX15;
+  this->misc[0x18] = &Chip8::opFX18;
+  this->misc[0x29] = &Chip8::opFX29;
+  this->misc[0x33] = &Chip8::opFX33;
+  switch (quirks) {
+    case QUIRKS_VIP:
+      this->fillQuirks<QUIRKS_VIP>();
+      break;
+    case QUIRKS_CHIP48:
+      this->fillQuirks<QUIRKS_CHIP48>();
+      break;
+    case QUIRKS_SCHIP:
+      this->fillQuirks<QUIRKS_SCHIP>();
+      break;
+    default:
+      this->fillQuirks<QUIRKS_MODERN>();
+  }
+}
+
+// the handlers whose behaviour depends on the quirk profile
+template <int QUIRKS>
+void Chip8::DispatchTables::fillQuirks(void) {
+  this->main[0xD] = &Chip8::opDXYN<QUIRKS>;
+  this->alu[0x6] = &Chip8::op8XY6<QUIRKS>;
+  this->alu[0xE] = &Chip8::op8XYE<QUIRKS>;
+  this->misc[0x1E] = &Chip8::opFX1E<QUIRKS>;
+  this->misc[0x55] = &Chip8::opFX55<QUIRKS>;
+  this->misc[0x65] = &Chip8::opFX65<QUIRKS>;
+}
+
+const Chip8::DispatchTables Chip8::tables[QUIRKS_COUNT] = {
+  DispatchTables(QUIRKS_MODERN), DispatchTables(QUIRKS_VIP), DispatchTables(QUIRKS_CHIP48), DispatchTables(QUIRKS_SCHIP)
+};
+
+void Chip8::decodeInstruction(uint16_t opcode, Instruction &ins) {
+  ins.opcode = opcode;
+  ins.x = (opcode & 0x0F00) >> 8;
+  ins.y = (opcode & 0x00F0) >> 4;
+  ins.n = opcode & 0x000F;
+  ins.nn = opcode & 0x00FF;
+  ins.nnn = opcode & 0x0FFF;
+  switch (opcode >> 12) {
+    case 0x8:
+      ins.handler = this->dispatch->alu[ins.n];
+      break;
+    case 0xE:
+      ins.handler = this->dispatch->key[ins.nn];
+      break;
+    case 0xF:
+      ins.handler = this->dispatch->misc[ins.nn];
+      break;
+    default:
+      ins.handler = this->dispatch->main[opcode >> 12];
+  }
+}
+
+void Chip8::decodeAt(uint16_t address) {
+  Instruction &ins = this->decoded[address];
+  uint16_t opcode = (this->memory[address] << 8) | this->memory[(address + 1) & 0xFFF];
+  this->decodeInstruction(opcode, ins);
+  if (ins.handler == &Chip8::op1NNN && this->isDelayLoop(address)) {
+    ins.handler = &Chip8::op1NNNIdle;
+  }
+}
+
+// decodes, and with the JIT translates, every indexed block ahead of its
+// first run
+void Chip8::warmBlocks(void) {
+  for (const BlockIndex::Block &block : this->block_index.blocks) {
+    if (block.start >= MEM_SIZE) {
+      continue;
+    }
+    for (int i = 0; i < block.length && block.start + i * 2 < MEM_SIZE; i++) {
+      if (this->decoded[block.start + i * 2].handler == NULL) {
+        this->decodeAt(block.start + i * 2);
+      }
+    }
+    if (this->jit != NULL) {
+      this->jit->warm(block.start);
+    }
+  }
+}
+
+void Chip8::invalidateDecoded(uint16_t address, int length) {
+  // an instruction starting one byte earlier also covers address
+  for (int i = -1; i < length; i++) {
+    this->decoded[(address + i) & 0xFFF].handler = NULL;
+  }
+  if (this->jit != NULL) {
+    this->jit->invalidate(address, length);
+  }
+  if (this->static_program != NULL) {
+    for (int i = -1; i < length; i++) {
+      if (this->static_program->coverage[(address + i) & 0xFFF]) {
+        // translated code was overwritten, interpret from now on
+        log("Static code modified, falling back to the interpreter\n");
+        this->static_program = NULL;
+        break;
+      }
+    }
+  }
+}
+
 void Chip8::executeOpcode() {
+  Instruction ins;
+  this->decodeInstruction(this->current_opcode, ins);
+  if (ins.handler == &Chip8::op1NNN && this->isDelayLoop(this->program_counter & 0xFFF)) {
+    ins.handler = &Chip8::op1NNNIdle;
+  }
+  (this->*ins.handler)(ins);
+}
+
+void Chip8::op0Group(const Instruction &ins) {
+  if (ins.opcode == 0x0000) {
+    // no more instructions to execute
+    this->game_finished = true;
+    return;
+  }
+  log("Opcode: 0x%.4X\n", ins.opcode);
+  if (ins.opcode == 0x00E0) {
+    // clear the display
+    std::memset(this->screen, 0, sizeof(this->screen));
+    this->program_counter += 2;
+    log(" Clearing display\n");
+    return;
+  }
+  if (ins.opcode == 0x00EE) {
+    // return from subroutine
+    this->program_counter = this->stack[--this->stack_ptr] + 2;
+    log(" Returning from subroutine\n");
+    return;
+  }
+  this->opUnknown(ins);
+}
+
+void Chip8::op1NNN(const Instruction &ins) {
+  // sets PC to 0x0NNN
+  uint16_t jump_address = ins.nnn;
+  this->program_counter = jump_address;
+  log(" Jump to 0x%.4X\n", jump_address);
+}
+
+void Chip8::op1NNNIdle(const Instruction &ins) {
+  this->op1NNN(ins);
+  this->idle_loop = true;
+}
+
+void Chip8::op2NNN(const Instruction &ins) {
+  // call to a subroutine at 0x0NNN
+  uint16_t routine_address = ins.nnn;
+  this->stack[this->stack_ptr] = this->program_counter;
+  this->stack_ptr++;
+  this->program_counter = routine_address;
+  log(" Call to a subroutine at 0x%.4X\n", routine_address);
+}
+
+void Chip8::op3XNN(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  uint8_t value = ins.nn;
+  if (this->registers[register_index] == value) {
+    this->program_counter += 4;
+  } else {
+    this->program_counter += 2;
+  }
+  log(" Skip instruction if V[%hhu] == %hhu\n", register_index, value);
+}
+
+void Chip8::op4XNN(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  uint8_t value = ins.nn;
+  if (this->registers[register_index] != value) {
+    this->program_counter += 4;
+  } else {
+    this->program_counter += 2;
+  }
+  log(" Skip instruction if V[%hhu] != %hhu\n", register_index, value);
+}
+
+void Chip8::op5XY0(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  if (this->registers[register_index1] == this->registers[register_index2]) {
+    this->program_counter += 4;
+  } else {
+    this->program_counter += 2;
+  }
+  log(" Skip instruction if V[%hhu] == V[%hhu]\n", register_index1, register_index2);
+}
+
+void Chip8::op6XNN(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  uint8_t value = ins.nn;
+  this->registers[register_index] = value;
+  this->program_counter += 2;
+  log(" Set V[%hhu] to %hhu\n", register_index, value);
+}
+
+void Chip8::op7XNN(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  uint8_t value = ins.nn;
+  this->registers[register_index] += value;
+  this->program_counter += 2;
+  log(" Add %hhu to V[%hhu]\n", value, register_index);
+}
+
+void Chip8::op8XY0(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  this->registers[register_index1] = this->registers[register_index2];
+  this->program_counter += 2;
+  log(" V[%hhu] = V[%hhu]\n", register_index1, register_index2);
+}
+
+void Chip8::op8XY1(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  this->registers[register_index1] |= this->registers[register_index2];
+  this->program_counter += 2;
+  log(" V[%hhu] |= V[%hhu]\n", register_index1, register_index2);
+}
+
+void Chip8::op8XY2(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  this->registers[register_index1] &= this->registers[register_index2];
+  this->program_counter += 2;
+  log(" V[%hhu] &= V[%hhu]\n", register_index1, register_index2);
+}
+
+void Chip8::op8XY3(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  this->registers[register_index1] ^= this->registers[register_index2];
+  this->program_counter += 2;
+  log(" V[%hhu] ^= V[%hhu]\n", register_index1, register_index2);
+}
+
+void Chip8::op8XY4(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  uint8_t value1 = this->registers[register_index1];
+  uint8_t value2 = this->registers[register_index2];
+  this->registers[0xF] = ((0x00FF - value1) < value2); // set carry
+  this->registers[register_index1] += value2;
+  this->program_counter += 2;
+  log(" V[%hhu] += V[%hhu]\n", register_index1, register_index2);
+}
+
+void Chip8::op8XY5(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  uint8_t value1 = this->registers[register_index1];
+  uint8_t value2 = this->registers[register_index2];
+  this->registers[0xF] = (value1 > value2); // set borrow
+  this->registers[register_index1] -= value2;
+  this->program_counter += 2;
+  log(" V[%hhu] -= V[%hhu]\n", register_index1, register_index2);
+}
+
+template <int QUIRKS>
+void Chip8::op8XY6(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  if constexpr (quirk_profiles[QUIRKS].shift_vy) {
+    uint8_t value = this->registers[ins.y];
+    this->registers[register_index] = value >> 1;
+    this->registers[0xF] = value & 0x01;
+  } else {
+    this->registers[0xF] = this->registers[register_index] & 0x01;
+    this->registers[register_index] >>= 1;
+  }
+  this->program_counter += 2;
+  log(" V[0xF] = V[%hhu] & 0x01 and shift by 1\n", register_index);
+}
+
+void Chip8::op8XY7(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  uint8_t value1 = this->registers[register_index1];
+  uint8_t value2 = this->registers[register_index2];
+  this->registers[0xF] = (value1 < value2); // set borrow
+  this->registers[register_index1] = value2 - value1;
+  this->program_counter += 2;
+  log(" V[%hhu] = %hhu - %hhu\n", register_index1, value1, value2);
+}
+
+template <int QUIRKS>
+void Chip8::op8XYE(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  if constexpr (quirk_profiles[QUIRKS].shift_vy) {
+    uint8_t value = this->registers[ins.y];
+    this->registers[register_index] = value << 1;
+    this->registers[0xF] = value >> 7;
+  } else {
+    this->registers[0xF] = this->registers[register_index] >> 7;
+    this->registers[register_index] <<= 1;
+  }
+  this->program_counter += 2;
+  log(" V[0xF] = V[%hhu] >> 7 and shift by 1\n", register_index);
+}
+
+void Chip8::op9XY0(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  if (this->registers[register_index1] != this->registers[register_index2]) {
+    this->program_counter += 4;
+  } else {
+    this->program_counter += 2;
+  }
+  log(" Skip instruction if V[%hhu] != V[%hhu]\n", register_index1, register_index2);
+}
+
+void Chip8::opANNN(const Instruction &ins) {
+  uint16_t address = ins.nnn;
+  this->index_register = address;
+  this->program_counter += 2;
+  log(" Set index register to 0x%.4X\n", address);
+}
+
+void Chip8::opBNNN(const Instruction &ins) {
+  uint16_t jump_address = ins.nnn;
+  this->program_counter = this->registers[0] + jump_address;
+  log(" Set PC to 0x%.4X + 0x%.4X\n", jump_address, this->registers[0]);
+}
+
+void Chip8::opCXNN(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  uint8_t value = ins.nn;
+  this->registers[register_index] = (this->nextRandom() % 0xFF) & value;
+  this->program_counter += 2;
+  log(" rand()\n");
+}
+
+template <int QUIRKS>
+void Chip8::opDXYN(const Instruction &ins) {
+  uint8_t register_index1 = ins.x;
+  uint8_t register_index2 = ins.y;
+  uint8_t x = registers[register_index1];
+  uint8_t y = registers[register_index2];
+  uint8_t height = ins.n;
+  registers[0xF] = 0x0;
+  uint8_t shift = x % SCREEN_WIDTH;
+  uint64_t collision = 0;
+  if constexpr (quirk_profiles[QUIRKS].clip_sprites) {
+    // the sprite starts wrapped onto the screen, pixels past the right
+    // and bottom edges are dropped
+    uint8_t top = y % SCREEN_HEIGHT;
+    int rows = std::min(height, (uint8_t)(SCREEN_HEIGHT - top));
+    for (int yline = 0; yline < rows; yline++) {
+      uint64_t sprite = ((uint64_t)memory[index_register + yline] << (SCREEN_WIDTH - 8)) >> shift;
+      collision |= screen[top + yline] & sprite;
+      screen[top + yline] ^= sprite;
+    }
+  } else {
+    // pixels past the right edge continue on the next row, so a sprite row
+    // is rotated into place and split between two rows by a mask
+    uint64_t first_row_mask = ~0ULL >> shift;
+    uint8_t row = (x / SCREEN_WIDTH + y) % SCREEN_HEIGHT;
+    for (int yline = 0; yline < height; yline++) {
+      uint64_t sprite = (uint64_t)memory[index_register + yline] << (SCREEN_WIDTH - 8);
+      sprite = (sprite >> shift) | (sprite << ((SCREEN_WIDTH - shift) % SCREEN_WIDTH));
+      uint8_t next_row = (row + 1) % SCREEN_HEIGHT;
+      uint64_t left = sprite & first_row_mask;
+      uint64_t right = sprite & ~first_row_mask;
+      collision |= (screen[row] & left) | (screen[next_row] & right);
+      screen[row] ^= left;
+      screen[next_row] ^= right;
+      row = next_row;
+    }
+  }
+  if (collision != 0) {
+    registers[0xF] = 0x1;
+  }
+  this->should_draw = true;
+  this->program_counter += 2;
+  log(" DRAW\n");
+}
+
+void Chip8::opEX9E(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  if (this->keyPressed(registers[register_index])) {
+    this->program_counter += 4;
+  } else {
+    this->program_counter += 2;
+  }
+  log(" Checking if key pressed\n");
+}
+
+void Chip8::opEXA1(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  if (!this->keyPressed(registers[register_index])) {
+    this->program_counter += 4;
+  } else {
+    this->program_counter += 2;
+  }
+  log(" Checking if key not pressed\n");
+}
+
+void Chip8::opFX07(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  this->registers[register_index] = this->delay_timer;
+  this->program_counter += 2;
+  log(" V[%hhu] = delay\n", register_index);
+}
+
+void Chip8::opFX0A(const Instruction &ins) {
+  log(" Waiting for a keypress\n");
+  int8_t key = this->getKey();
+  if (key == -1) {
+    // no key pressed
+    this->idle_loop = true;
+    return;
+  }
+  uint8_t register_index = ins.x;
+  this->registers[register_index] = key;
+  this->program_counter += 2;
+}
+
+void Chip8::opFX15(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  this->delay_timer = this->registers[register_index];
+  this->program_counter += 2;
+  log(" Delay timer set to %hhu\n", this->delay_timer);
+}
+
+void Chip8::opFX18(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  this->sound_timer = this->registers[register_index];
+  this->program_counter += 2;
+  log(" Sound timer set to %hhu\n", this->sound_timer);
+}
+
+template <int QUIRKS>
+void Chip8::opFX1E(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  uint8_t value = this->registers[register_index];
+  if constexpr (quirk_profiles[QUIRKS].index_overflow_flag) {
+    this->registers[0xF] = this->index_register + value > 0xFFF;
+  }
+  this->index_register += value;
+  this->program_counter += 2;
+  log(" Index += V[%hhu]\n", register_index);
+}
+
+void Chip8::opFX29(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  uint8_t value = this->registers[register_index];
+  this->index_register = value * 0x5;
+  this->program_counter += 2;
+}
+
+void Chip8::opFX33(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  memory[index_register] = registers[register_index] / 100;
+  memory[index_register + 1] = (registers[register_index] / 10) % 10;
+  memory[index_register + 2] = (registers[register_index] % 100) % 10;
+  this->invalidateDecoded(index_register, 3);
+  this->program_counter += 2;
+  log(" BCD\n");
+}
+
+template <int QUIRKS>
+void Chip8::opFX55(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  for (int i = 0; i <= register_index; i++) {
+    memory[index_register + i] = registers[i];
+  }
+  this->invalidateDecoded(index_register, register_index + 1);
+  if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X) {
+    index_register += register_index;
+  } else if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X_PLUS_1) {
+    index_register += register_index + 1;
+  }
+  this->program_counter += 2;
+  log(" Reg dump\n");
+}
+
+template <int QUIRKS>
+void Chip8::opFX65(const Instruction &ins) {
+  uint8_t register_index = ins.x;
+  for (int i = 0; i <= register_index; ++i) {
+    registers[i] = memory[index_register + i];
+  }
+  if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X) {
+    index_register += register_index;
+  } else if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X_PLUS_1) {
+    index_register += register_index + 1;
+  }
+  this->program_counter += 2;
+  log(" Reg load\n");
+}
+
+void Chip8::opUnknown(const Instruction &) {
+  log(" Unknown opcode\n");
+  this->program_counter += 2;
+}
+
+// reference if-chain decoder, kept to validate and benchmark the tables against
+void Chip8::executeOpcodeReference() {
+  (this->*reference_decoder)();
+}
+
+template <int QUIRKS>
+void Chip8::referenceOpcode(void) {
   uint16_t opcode = this->current_opcode;
   if (opcode == 0x0000) {
     // no more instructions to execute
@@ -212,7 +1226,7 @@ void Chip8::executeOpcode() {
   log("Opcode: 0x%.4X\n", opcode);
   if (opcode == 0x00E0) {
     // clear the display
-    std::memset(this->screen, 0, SCREEN_WIDTH * SCREEN_HEIGHT);
+    std::memset(this->screen, 0, sizeof(this->screen));
     this->program_counter += 2;
     log(" Clearing display\n");
     return;
@@ -345,8 +1359,14 @@ void Chip8::executeOpcode() {
     }
     if ((opcode & 0x000F) == 0x0006) {
       uint8_t register_index = (opcode & 0x0F00) >> 8;
-      this->registers[0xF] = this->registers[register_index] & 0x01;
-      this->registers[register_index] >>= 1;
+      if constexpr (quirk_profiles[QUIRKS].shift_vy) {
+        uint8_t value = this->registers[(opcode & 0x00F0) >> 4];
+        this->registers[register_index] = value >> 1;
+        this->registers[0xF] = value & 0x01;
+      } else {
+        this->registers[0xF] = this->registers[register_index] & 0x01;
+        this->registers[register_index] >>= 1;
+      }
       this->program_counter += 2;
       log(" V[0xF] = V[%hhu] & 0x01 and shift by 1\n", register_index);
       return;
@@ -364,8 +1384,14 @@ void Chip8::executeOpcode() {
     }
     if ((opcode & 0x000F) == 0x000E) {
       uint8_t register_index = (opcode & 0x0F00) >> 8;
-      this->registers[0xF] = this->registers[register_index] >> 7;
-      this->registers[register_index] <<= 1;
+      if constexpr (quirk_profiles[QUIRKS].shift_vy) {
+        uint8_t value = this->registers[(opcode & 0x00F0) >> 4];
+        this->registers[register_index] = value << 1;
+        this->registers[0xF] = value >> 7;
+      } else {
+        this->registers[0xF] = this->registers[register_index] >> 7;
+        this->registers[register_index] <<= 1;
+      }
       this->program_counter += 2;
       log(" V[0xF] = V[%hhu] >> 7 and shift by 1\n", register_index);
       return;
@@ -398,7 +1424,7 @@ void Chip8::executeOpcode() {
   if ((opcode & 0xF000) == 0xC000) {
     uint8_t register_index = (opcode & 0x0F00) >> 8;
     uint8_t value = opcode & 0x00FF;
-    this->registers[register_index] = (rand() % 0xFF) & value;
+    this->registers[register_index] = (this->nextRandom() % 0xFF) & value;
     this->program_counter += 2;
     log(" rand()\n");
     return;
@@ -415,10 +1441,19 @@ void Chip8::executeOpcode() {
       for (int xline = 0; xline < 8; xline++) {
         if ((pixel & (0x80 >> xline)) != 0) {
           int index = (x + xline + ((y + yline) * 64)) % (32 * 64);
-          if (screen[index] == 1) {
+          if constexpr (quirk_profiles[QUIRKS].clip_sprites) {
+            int pixel_x = x % 64 + xline;
+            int pixel_y = y % 32 + yline;
+            if (pixel_x >= 64 || pixel_y >= 32) {
+              continue;
+            }
+            index = pixel_x + pixel_y * 64;
+          }
+          uint64_t bit = 1ULL << (63 - index % 64);
+          if (screen[index / 64] & bit) {
             registers[0xF] = 0x1;
           }
-          screen[index] ^= 1;
+          screen[index / 64] ^= bit;
         }
       }
     }
@@ -430,7 +1465,7 @@ void Chip8::executeOpcode() {
   if ((opcode & 0xF000) == 0xE000) {
     if ((opcode & 0x00FF) == 0x009E) {
       uint8_t register_index = (opcode & 0x0F00) >> 8;
-      if (keys[registers[register_index]]) {
+      if (this->keyPressed(registers[register_index])) {
         this->program_counter += 4;
       } else {
         this->program_counter += 2;
@@ -440,7 +1475,7 @@ void Chip8::executeOpcode() {
     }
     if ((opcode & 0x00FF) == 0x00A1) {
       uint8_t register_index = (opcode & 0x0F00) >> 8;
-      if (!keys[registers[register_index]]) {
+      if (!this->keyPressed(registers[register_index])) {
         this->program_counter += 4;
       } else {
         this->program_counter += 2;
@@ -486,7 +1521,9 @@ void Chip8::executeOpcode() {
     if ((opcode & 0x00FF) == 0x001E) {
       uint8_t register_index = (opcode & 0x0F00) >> 8;
       uint8_t value = this->registers[register_index];
-      this->registers[0xF] = this->index_register + value > 0xFFF;
+      if constexpr (quirk_profiles[QUIRKS].index_overflow_flag) {
+        this->registers[0xF] = this->index_register + value > 0xFFF;
+      }
       this->index_register += value;
       this->program_counter += 2;
       log(" Index += V[%hhu]\n", register_index);
@@ -504,6 +1541,7 @@ void Chip8::executeOpcode() {
       memory[index_register] = registers[register_index] / 100;
       memory[index_register + 1] = (registers[register_index] / 10) % 10;
       memory[index_register + 2] = (registers[register_index] % 100) % 10;
+      this->invalidateDecoded(index_register, 3);
       this->program_counter += 2;
       log(" BCD\n");
       return;
@@ -513,7 +1551,12 @@ void Chip8::executeOpcode() {
       for (int i = 0; i <= register_index; i++) {
         memory[index_register + i] = registers[i];
       }
-      // index_register += register_index + 1;
+      this->invalidateDecoded(index_register, register_index + 1);
+      if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X) {
+        index_register += register_index;
+      } else if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X_PLUS_1) {
+        index_register += register_index + 1;
+      }
       this->program_counter += 2;
       log(" Reg dump\n");
       return;
@@ -523,7 +1566,11 @@ void Chip8::executeOpcode() {
       for (int i = 0; i <= register_index; ++i) {
         registers[i] = memory[index_register + i];
       }
-      // index_register += register_index + 1;
+      if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X) {
+        index_register += register_index;
+      } else if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X_PLUS_1) {
+        index_register += register_index + 1;
+      }
       this->program_counter += 2;
       log(" Reg load\n");
       return;
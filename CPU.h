@@ -2,43 +2,219 @@
 #define __CPU_
 
 #include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "Profile.h"
+#include "Quirks.h"
+#include "BlockIndex.h"
+#include "Chip8State.h"
 
-#define MEM_SIZE 4096
-#define REGISTER_COUNT 16
-#define SCREEN_WIDTH 64
-#define SCREEN_HEIGHT 32
-#define STACK_SIZE 48
-#define KEYS_COUNT 16
+#define MEM_SIZE CHIP8_MEM_SIZE
+#define REGISTER_COUNT CHIP8_REGISTER_COUNT
+#define SCREEN_WIDTH CHIP8_SCREEN_WIDTH
+#define SCREEN_HEIGHT CHIP8_SCREEN_HEIGHT
+#define SCREEN_PIXEL CHIP8_SCREEN_PIXEL
+#define STACK_SIZE CHIP8_STACK_SIZE
+#define KEYS_COUNT CHIP8_KEYS_COUNT
 #define INTERPRETER_SIZE 0x200
 #define MAX_ROM_SIZE (0xFFF - INTERPRETER_SIZE)
+#define DEFAULT_CYCLES_PER_SECOND 500
+#define FRAMES_PER_SECOND 60
+#define TIMER_FREQUENCY 60
+// bumped whenever the layout of Chip8State changes
+#define STATE_VERSION 2
+// timers follow emulated time, one tick per cycles_per_second / 60 cycles
+#define TIMER_VIRTUAL 0
+// timers tick once per 60 Hz frame of runEmu, whatever the cycle rate
+#define TIMER_WALLCLOCK 1
 
-class Chip8 {
+class Jit;
+class Frontend;
+class FrameBuffer;
+class Rewind;
+class InputLog;
+class Chip8;
+
+// A ROM translated ahead of time by chip8rc. run_block executes the
+// translated blocks starting at the program counter and returns the
+// number of cycles they took, or 0 if the interpreter has to step.
+struct StaticProgram {
+  const uint8_t *rom;
+  int rom_size;
+  const uint8_t *coverage; // nonzero for every byte of translated code
+  uint32_t (*run_block)(Chip8 *chip, uint32_t budget, uint32_t timer_window);
+  int quirks; // the profile the code was translated for
+};
+
+// used by loadGame whenever the loaded ROM matches the program
+void registerStaticProgram(const StaticProgram *program);
+
+class Chip8 : public Chip8State {
+  friend class Jit;
   public:
-    Chip8(void);
-    uint16_t current_opcode;
-    uint8_t memory[MEM_SIZE];
-    uint8_t registers[REGISTER_COUNT];
-    uint16_t program_counter;
-    uint16_t index_register;
-    uint8_t delay_timer;
-    uint8_t sound_timer;
-    uint8_t keys[KEYS_COUNT];
-    uint16_t stack[STACK_SIZE];
-    uint8_t stack_ptr;
-    uint8_t timer_counter;
+    Chip8(Frontend *frontend = NULL);
+    ~Chip8(void);
+    Chip8(const Chip8 &) = delete;
+    Chip8 &operator=(const Chip8 &) = delete;
+    // bit i is set while key i is held, written by the frontend's input
+    // thread and read by the CPU without locking
+    std::atomic<uint16_t> keys;
+    int timer_mode;
     volatile bool game_finished;
     void executeOpcode();
+    void executeOpcodeReference();
+    bool reference_dispatch;
     void executeCycle(void);
+    // runs up to count cycles, stopping early once the game finishes or
+    // a frame is ready to be drawn; returns the number of cycles executed
+    uint32_t runCycles(uint32_t count);
+    void enableJit(bool enabled);
+    // records every frame of runEmu so the frontend can step back in time
+    void enableRewind(bool enabled);
+    // cycles run through runCycles, input logs are keyed by it
+    uint64_t cycle_count;
+    void seedRandom(uint32_t seed);
+    uint32_t nextRandom(void) {
+      uint32_t x = this->random_state;
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      return this->random_state = x;
+    }
+    // logs the seed, settings, key changes and wall clock ticks of the
+    // following runEmu; rewinding is disabled while recording
+    void recordInput(InputLog *log);
+    // runs the logged session unthrottled until max_cycles, returns the
+    // number of cycles run
+    uint64_t replayInput(const InputLog &log, uint64_t max_cycles);
     int8_t getKey(void);
+    bool keyPressed(uint8_t index) {
+      return index < KEYS_COUNT && ((this->keys.load(std::memory_order_relaxed) >> index) & 1);
+    }
     void drawScreen(void);
     volatile bool should_draw;
-    void checkInput(void);
+    // also warms the decode and translation caches from name.blocks when
+    // chip8dasm --flow has indexed this ROM
     bool loadGame(const char *name);
+    // copies size bytes of ROM to 0x200, for ROMs that aren't in a file
+    bool loadGame(const uint8_t *rom, int size);
+    // back to power on with no ROM loaded, keeping the clock, quirks, JIT
+    // and random generator
+    void reset(void);
     void runEmu(void);
+    void setClockSpeed(uint32_t cycles_per_second);
+    uint32_t cycles_per_second;
+    // runs unthrottled, frames are still presented at 60 Hz
+    void setTurbo(bool turbo);
+    bool turbo;
+    void setTimerMode(int mode);
+    // picks one of the prebuilt QUIRKS_* cores, drops decoded and
+    // translated code made for the previous one
+    void setQuirks(int profile);
+    int quirks;
     void setKey(uint8_t index);
     void clearKeys(void);
-    uint8_t screen[SCREEN_WIDTH * SCREEN_HEIGHT];
-    int pressed_key;
+    // restoring only drops decoded and translated code for memory that
+    // differs from the current state
+    void saveState(Chip8State &state);
+    void loadState(const Chip8State &state);
+    bool saveStateFile(const char *name);
+    bool loadStateFile(const char *name);
+    // must be called after writing to memory directly
+    void invalidateDecoded(uint16_t address, int length);
+    // writes the execution profile, false unless built with PROFILE=1
+    bool writeProfile(std::FILE *out);
+  private:
+    Frontend *frontend;
+    Jit *jit;
+    // frames waiting for the render thread while runEmu is running
+    FrameBuffer *frames;
+    Rewind *rewind;
+    InputLog *input_log;
+    // the frontend's keys while recording, copied to keys once per frame
+    std::atomic<uint16_t> live_keys;
+    std::atomic<bool> rendering;
+    std::atomic<bool> sound_on;
+    void renderFrames(void);
+    const StaticProgram *static_program;
+    #if PROFILE
+      Profile profile;
+    #endif
+    int32_t jit_budget; // cycles the translated code may still run
+    BlockIndex block_index; // of the loaded ROM, empty without one
+    void warmBlocks(void);
+    void executeDecoded(void);
+    bool runFrameCycles(uint32_t count);
+    bool idle_loop; // set by handlers that spin waiting for a key or timer
+    bool idle; // the last batch ended in a wait only input can break
+    bool isDelayLoop(uint16_t jump_address);
+    uint32_t skipIdleCycles(uint32_t max_cycles);
+    uint32_t timer_step;
+    void tickTimers(void);
+    void updateTimers(void);
+    void advanceTimers(uint32_t cycles);
+    uint32_t cyclesUntilTimerTick(void);
+    struct Instruction;
+    typedef void (Chip8::*OpcodeHandler)(const Instruction &ins);
+    struct Instruction {
+      OpcodeHandler handler; // NULL until decoded
+      uint16_t opcode;
+      uint16_t nnn;
+      uint8_t x;
+      uint8_t y;
+      uint8_t n;
+      uint8_t nn;
+    };
+    Instruction decoded[MEM_SIZE];
+    struct DispatchTables {
+      OpcodeHandler main[16]; // keyed on the high nibble
+      OpcodeHandler alu[16]; // 0x8XYN, keyed on N
+      OpcodeHandler key[256]; // 0xEXNN, keyed on NN
+      OpcodeHandler misc[256]; // 0xFXNN, keyed on NN
+      DispatchTables(int quirks);
+      template <int QUIRKS> void fillQuirks(void);
+    };
+    static const DispatchTables tables[QUIRKS_COUNT];
+    const DispatchTables *dispatch; // the tables of the current profile
+    void decodeInstruction(uint16_t opcode, Instruction &ins);
+    void decodeAt(uint16_t address);
+    void (Chip8::*reference_decoder)(void);
+    template <int QUIRKS> void referenceOpcode(void);
+    void op0Group(const Instruction &ins);
+    void op1NNN(const Instruction &ins);
+    void op1NNNIdle(const Instruction &ins);
+    void op2NNN(const Instruction &ins);
+    void op3XNN(const Instruction &ins);
+    void op4XNN(const Instruction &ins);
+    void op5XY0(const Instruction &ins);
+    void op6XNN(const Instruction &ins);
+    void op7XNN(const Instruction &ins);
+    void op8XY0(const Instruction &ins);
+    void op8XY1(const Instruction &ins);
+    void op8XY2(const Instruction &ins);
+    void op8XY3(const Instruction &ins);
+    void op8XY4(const Instruction &ins);
+    void op8XY5(const Instruction &ins);
+    template <int QUIRKS> void op8XY6(const Instruction &ins);
+    void op8XY7(const Instruction &ins);
+    template <int QUIRKS> void op8XYE(const Instruction &ins);
+    void op9XY0(const Instruction &ins);
+    void opANNN(const Instruction &ins);
+    void opBNNN(const Instruction &ins);
+    void opCXNN(const Instruction &ins);
+    template <int QUIRKS> void opDXYN(const Instruction &ins);
+    void opEX9E(const Instruction &ins);
+    void opEXA1(const Instruction &ins);
+    void opFX07(const Instruction &ins);
+    void opFX0A(const Instruction &ins);
+    void opFX15(const Instruction &ins);
+    void opFX18(const Instruction &ins);
+    template <int QUIRKS> void opFX1E(const Instruction &ins);
+    void opFX29(const Instruction &ins);
+    void opFX33(const Instruction &ins);
+    template <int QUIRKS> void opFX55(const Instruction &ins);
+    template <int QUIRKS> void opFX65(const Instruction &ins);
+    void opUnknown(const Instruction &ins);
 };
 
 #endif // __CPU_
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef __CHIP8_STATE_
+#define __CHIP8_STATE_
+
+#include <stdint.h>
+
+// prefixed since libchip8.h hands this header to embedders, CPU.h gives
+// the core its short names for them
+#define CHIP8_MEM_SIZE 4096
+#define CHIP8_REGISTER_COUNT 16
+#define CHIP8_SCREEN_WIDTH 64
+#define CHIP8_SCREEN_HEIGHT 32
+// screen rows are packed into 64 bit words, leftmost pixel first
+#define CHIP8_SCREEN_PIXEL(screen, x, y) (((screen)[y] >> (CHIP8_SCREEN_WIDTH - 1 - (x))) & 1)
+#define CHIP8_STACK_SIZE 48
+#define CHIP8_KEYS_COUNT 16
+
+// Machine state captured by savestates. It is plain data, so a snapshot
+// or a restore is a single copy. Kept valid C for libchip8's C API.
+typedef struct Chip8State {
+  uint16_t current_opcode;
+  uint8_t memory[CHIP8_MEM_SIZE];
+  uint8_t registers[CHIP8_REGISTER_COUNT];
+  uint16_t program_counter;
+  uint16_t index_register;
+  uint8_t delay_timer;
+  uint8_t sound_timer;
+  uint16_t stack[CHIP8_STACK_SIZE];
+  uint8_t stack_ptr;
+  uint32_t timer_phase; // emulated time since the last tick, in 1/60 cycles
+  // one word per row, the leftmost pixel in the most significant bit
+  uint64_t screen[CHIP8_SCREEN_HEIGHT];
+  uint32_t random_state; // xorshift32 state behind CXNN
+} Chip8State;
+
+#endif // __CHIP8_STATE_
\ No newline at end of file
@@ -0,0 +1,515 @@
+#include <cstdio>
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Disassembler.h"
+
+#define OPERANDS_NONE 0
+#define OPERANDS_ADDRESS 1 // 0xNNNN
+#define OPERANDS_X 2 // VX
+#define OPERANDS_X_NN 3 // VX, NN
+#define OPERANDS_X_Y 4 // VX, VY
+#define OPERANDS_X_Y_N 5 // VX, VY, N
+
+// how control leaves an instruction
+#define FLOW_NEXT 0 // falls through
+#define FLOW_JUMP 1 // static jump to NNN
+#define FLOW_SKIP 2 // conditional skip of the next instruction
+#define FLOW_CALL 3 // subroutine call, returns to the next instruction
+#define FLOW_END 4 // returns, jumps through V0 or isn't CHIP-8 code
+
+struct OpcodeFormat {
+  uint16_t mask;
+  uint16_t match;
+  OpcodeKind kind;
+  const char *mnemonic; // NULL for words the listing skips
+  int operands;
+};
+
+// the syntax of http://devernay.free.fr/hacks/chip8/chip8def.htm, the
+// first entry matches nothing and the last catches the rest of 0NNN
+static const OpcodeFormat opcode_formats[] = {
+  {0x0000, 0xFFFF, KIND_UNKNOWN, NULL, OPERANDS_NONE},
+  {0xFFFF, 0x00E0, KIND_00E0, "CLS", OPERANDS_NONE},
+  {0xFFFF, 0x00EE, KIND_00EE, "RTS", OPERANDS_NONE},
+  {0xF000, 0x1000, KIND_1NNN, "JMP", OPERANDS_ADDRESS},
+  {0xF000, 0x2000, KIND_2NNN, "JSR", OPERANDS_ADDRESS},
+  {0xF000, 0x3000, KIND_3XNN, "SKEQ", OPERANDS_X_NN},
+  {0xF000, 0x4000, KIND_4XNN, "SKNE", OPERANDS_X_NN},
+  {0xF000, 0x5000, KIND_5XY0, "SKEQ", OPERANDS_X_Y},
+  {0xF000, 0x6000, KIND_6XNN, "MOV", OPERANDS_X_NN},
+  {0xF000, 0x7000, KIND_7XNN, "ADD", OPERANDS_X_NN},
+  {0xF00F, 0x8000, KIND_8XY0, "MOV", OPERANDS_X_Y},
+  {0xF00F, 0x8001, KIND_8XY1, "OR", OPERANDS_X_Y},
+  {0xF00F, 0x8002, KIND_8XY2, "AND", OPERANDS_X_Y},
+  {0xF00F, 0x8003, KIND_8XY3, "XOR", OPERANDS_X_Y},
+  {0xF00F, 0x8004, KIND_8XY4, "ADD", OPERANDS_X_Y},
+  {0xF00F, 0x8005, KIND_8XY5, "SUB", OPERANDS_X_Y},
+  {0xF00F, 0x8006, KIND_8XY6, "SHR", OPERANDS_X},
+  {0xF00F, 0x8007, KIND_8XY7, "RSB", OPERANDS_X_Y},
+  {0xF00F, 0x800E, KIND_8XYE, "SHL", OPERANDS_X},
+  {0xF000, 0x9000, KIND_9XY0, "SKNE", OPERANDS_X_Y},
+  {0xF000, 0xA000, KIND_ANNN, "MVI", OPERANDS_ADDRESS},
+  {0xF000, 0xB000, KIND_BNNN, "JMI", OPERANDS_ADDRESS},
+  {0xF000, 0xC000, KIND_CXNN, "RAND", OPERANDS_X_NN},
+  {0xF000, 0xD000, KIND_DXYN, "SPRITE", OPERANDS_X_Y_N},
+  {0xF0FF, 0xE09E, KIND_EX9E, "SKPR", OPERANDS_X},
+  {0xF0FF, 0xE0A1, KIND_EXA1, "SKUP", OPERANDS_X},
+  {0xF0FF, 0xF007, KIND_FX07, "GDELAY", OPERANDS_X},
+  {0xF0FF, 0xF00A, KIND_FX0A, "KEY", OPERANDS_X},
+  {0xF0FF, 0xF015, KIND_FX15, "SDELAY", OPERANDS_X},
+  {0xF0FF, 0xF018, KIND_FX18, "SSOUND", OPERANDS_X},
+  {0xF0FF, 0xF01E, KIND_FX1E, "ADI", OPERANDS_X},
+  {0xF0FF, 0xF029, KIND_FX29, "FONT", OPERANDS_X},
+  {0xF0FF, 0xF033, KIND_FX33, "BCD", OPERANDS_X},
+  {0xF0FF, 0xF055, KIND_FX55, "STR", OPERANDS_X},
+  {0xF0FF, 0xF065, KIND_FX65, "LDR", OPERANDS_X},
+  {0xFFFF, 0x0000, KIND_0000, NULL, OPERANDS_NONE},
+  {0xFFF0, 0x00C0, KIND_SCHIP, NULL, OPERANDS_NONE},
+  {0xFFFF, 0x00FB, KIND_SCHIP, NULL, OPERANDS_NONE},
+  {0xFFFF, 0x00FC, KIND_SCHIP, NULL, OPERANDS_NONE},
+  {0xFFFF, 0x00FD, KIND_SCHIP, NULL, OPERANDS_NONE},
+  {0xFFFF, 0x00FE, KIND_SCHIP, NULL, OPERANDS_NONE},
+  {0xFFFF, 0x00FF, KIND_SCHIP, NULL, OPERANDS_NONE},
+  {0xF0FF, 0xF030, KIND_SCHIP, NULL, OPERANDS_NONE},
+  {0xF0FF, 0xF075, KIND_SCHIP, NULL, OPERANDS_NONE},
+  {0xF0FF, 0xF085, KIND_SCHIP, NULL, OPERANDS_NONE},
+  {0xF000, 0x0000, KIND_0NNN, NULL, OPERANDS_NONE}
+};
+
+#define FORMAT_COUNT (int)(sizeof(opcode_formats) / sizeof(opcode_formats[0]))
+
+const char *const opcode_kind_names[KIND_COUNT] = {
+  "00E0", "00EE", "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+  "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+  "9XY0", "ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1", "FX07", "FX0A",
+  "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65", "0000", "0NNN",
+  "SCHIP", "unknown"
+};
+
+// Every format is told apart by the top nibble and the low byte, so those
+// twelve bits pick the first candidate and a full mask check confirms it.
+// Only the 0NNN family looks at the middle nibbles, a miss there is 0NNN.
+struct FormatTable {
+  uint8_t formats[1 << 12];
+  FormatTable(void);
+};
+
+static inline int formatKey(uint16_t opcode) {
+  return ((opcode & 0xF000) >> 4) | (opcode & 0x00FF);
+}
+
+FormatTable::FormatTable(void) {
+  for (int key = 0; key < (1 << 12); key++) {
+    uint16_t opcode = ((key & 0xF00) << 4) | (key & 0xFF);
+    this->formats[key] = 0;
+    for (int i = 1; i < FORMAT_COUNT; i++) {
+      uint16_t mask = opcode_formats[i].mask & 0xF0FF;
+      if ((opcode & mask) == (opcode_formats[i].match & mask)) {
+        this->formats[key] = i;
+        break;
+      }
+    }
+  }
+}
+
+static const FormatTable format_table;
+
+static inline const OpcodeFormat &findFormat(uint16_t opcode) {
+  const OpcodeFormat &format = opcode_formats[format_table.formats[formatKey(opcode)]];
+  if ((opcode & format.mask) == format.match) {
+    return format;
+  }
+  return opcode_formats[(opcode & 0xF000) == 0 ? FORMAT_COUNT - 1 : 0];
+}
+
+static inline char *appendDecimal(char *out, unsigned value) {
+  if (value >= 100) {
+    *out++ = '0' + value / 100;
+  }
+  if (value >= 10) {
+    *out++ = '0' + value / 10 % 10;
+  }
+  *out++ = '0' + value % 10;
+  return out;
+}
+
+static inline char *appendRegister(char *out, unsigned index) {
+  *out++ = 'V';
+  return appendDecimal(out, index);
+}
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+static inline char *appendHex(char *out, unsigned value, int digits) {
+  *out++ = '0';
+  *out++ = 'x';
+  for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+    *out++ = hex_digits[(value >> shift) & 0xF];
+  }
+  return out;
+}
+
+static inline char *appendAddress(char *out, unsigned address) {
+  std::memcpy(out, "0x0", 3);
+  out[3] = hex_digits[(address >> 8) & 0xF];
+  out[4] = hex_digits[(address >> 4) & 0xF];
+  out[5] = hex_digits[address & 0xF];
+  return out + 6;
+}
+
+static inline char *appendLabel(char *out, unsigned address) {
+  out[0] = 'L';
+  out[1] = hex_digits[(address >> 8) & 0xF];
+  out[2] = hex_digits[(address >> 4) & 0xF];
+  out[3] = hex_digits[address & 0xF];
+  return out + 4;
+}
+
+// writes everything after the mnemonic's indent, jump and call targets
+// become labels where labels is given and marks them
+static inline char *appendInstruction(char *out, const OpcodeFormat &format, uint16_t opcode, const bool *labels) {
+  for (const char *c = format.mnemonic; *c != 0; c++) {
+    *out++ = *c;
+  }
+  unsigned x = (opcode & 0x0F00) >> 8;
+  unsigned y = (opcode & 0x00F0) >> 4;
+  if (format.operands != OPERANDS_NONE) {
+    *out++ = ' ';
+    *out++ = ' ';
+  }
+  switch (format.operands) {
+    case OPERANDS_ADDRESS:
+      if (labels != NULL && (format.kind == KIND_1NNN || format.kind == KIND_2NNN) && labels[opcode & 0x0FFF]) {
+        out = appendLabel(out, opcode & 0x0FFF);
+      } else {
+        out = appendAddress(out, opcode & 0x0FFF);
+      }
+      break;
+    case OPERANDS_X:
+      out = appendRegister(out, x);
+      break;
+    case OPERANDS_X_NN:
+      out = appendRegister(out, x);
+      *out++ = ',';
+      *out++ = ' ';
+      out = appendDecimal(out, opcode & 0x00FF);
+      break;
+    case OPERANDS_X_Y:
+    case OPERANDS_X_Y_N:
+      out = appendRegister(out, x);
+      *out++ = ',';
+      *out++ = ' ';
+      out = appendRegister(out, y);
+      if (format.operands == OPERANDS_X_Y_N) {
+        *out++ = ',';
+        *out++ = ' ';
+        out = appendDecimal(out, opcode & 0x000F);
+      }
+      break;
+  }
+  *out++ = '\n';
+  return out;
+}
+
+static int flowOf(OpcodeKind kind) {
+  switch (kind) {
+    case KIND_1NNN:
+      return FLOW_JUMP;
+    case KIND_2NNN:
+      return FLOW_CALL;
+    case KIND_3XNN:
+    case KIND_4XNN:
+    case KIND_5XY0:
+    case KIND_9XY0:
+    case KIND_EX9E:
+    case KIND_EXA1:
+      return FLOW_SKIP;
+    case KIND_00EE:
+    case KIND_BNNN:
+    case KIND_0000:
+    case KIND_0NNN:
+    case KIND_SCHIP:
+    case KIND_UNKNOWN:
+      return FLOW_END;
+    default:
+      return FLOW_NEXT;
+  }
+}
+
+Disassembler::Disassembler(void) {
+  this->trace = false;
+  this->flow = false;
+  this->rom = NULL;
+  this->rom_size = 0;
+  this->mapping = NULL;
+  this->output_length = 0;
+}
+
+Disassembler::Disassembler(std::string filename) : Disassembler() {
+  if (!this->load(filename)) {
+    std::cout << "Couldn't load " << filename << "\n";
+    std::exit(0);
+  }
+}
+
+Disassembler::Disassembler(const uint8_t *rom, int size) : Disassembler() {
+  this->rom = rom;
+  this->rom_size = size < MEM_SIZE ? size : MEM_SIZE;
+}
+
+Disassembler::~Disassembler(void) {
+  this->unload();
+}
+
+void Disassembler::unload(void) {
+  if (this->mapping != NULL) {
+    munmap(this->mapping, this->rom_size);
+  }
+  this->mapping = NULL;
+  this->rom = NULL;
+  this->rom_size = 0;
+}
+
+bool Disassembler::load(std::string filename) {
+  this->unload();
+  this->filename = filename;
+  int file = open(filename.c_str(), O_RDONLY);
+  if (file < 0) {
+    return false;
+  }
+  struct stat info;
+  bool loaded = fstat(file, &info) == 0 && S_ISREG(info.st_mode) && info.st_size <= MEM_SIZE;
+  // an empty file has nothing to map
+  if (loaded && info.st_size > 0) {
+    void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    loaded = mapping != MAP_FAILED;
+    if (loaded) {
+      this->mapping = mapping;
+      this->rom = (const uint8_t *)mapping;
+      this->rom_size = info.st_size;
+    }
+  }
+  close(file);
+  return loaded;
+}
+
+int Disassembler::size(void) {
+  return this->rom_size;
+}
+
+int Disassembler::disassemble(void) {
+  std::string name = this->filename.substr(0, this->filename.rfind("."));
+  std::FILE *output_file = std::fopen((name + ".chip8").c_str(), "w");
+  if (output_file == NULL) {
+    return -1;
+  }
+  int consumed = this->disassemble(output_file);
+  bool written = std::fclose(output_file) == 0;
+  if (this->flow) {
+    written &= this->blocks.save((name + ".blocks").c_str());
+  }
+  return written ? consumed : -1;
+}
+
+int Disassembler::disassemble(std::FILE *output_file) {
+  int consumed;
+  if (this->flow) {
+    this->findBlocks(this->blocks);
+    consumed = this->formatFlow();
+  } else {
+    consumed = this->format();
+  }
+  std::fwrite(this->output, 1, this->output_length, output_file);
+  return consumed;
+}
+
+// Fills the output buffer with the listing. Memory past the end of the
+// ROM reads as zero, just like in the interpreter.
+int Disassembler::format(void) {
+  char *out = this->output;
+  int pc = 0;
+  for (; pc < this->rom_size; pc += OPCODE_SIZE) {
+    uint16_t opcode = (this->rom[pc] << 8) | (pc + 1 < this->rom_size ? this->rom[pc + 1] : 0);
+    if (opcode == 0x0000) {
+      break;
+    }
+    if (this->trace) {
+      std::printf("opcode: 0x%.4X\n", opcode);
+    }
+    const OpcodeFormat &format = findFormat(opcode);
+    if (format.mnemonic != NULL) {
+      out = appendInstruction(out, format, opcode, NULL);
+    }
+  }
+  this->output_length = out - this->output;
+  // a zero word that stopped the listing counts as consumed, running off
+  // the end of the ROM consumes just the ROM
+  if (pc >= this->rom_size) {
+    return this->rom_size;
+  }
+  return std::min(pc + OPCODE_SIZE, this->rom_size);
+}
+
+OpcodeKind Disassembler::classify(uint16_t opcode) {
+  return findFormat(opcode).kind;
+}
+
+void Disassembler::count(uint64_t kinds[KIND_COUNT]) {
+  int pc = 0;
+  for (; pc + 1 < this->rom_size; pc += OPCODE_SIZE) {
+    kinds[findFormat((this->rom[pc] << 8) | this->rom[pc + 1]).kind]++;
+  }
+  if (pc < this->rom_size) {
+    kinds[findFormat(this->rom[pc] << 8).kind]++;
+  }
+}
+
+uint16_t Disassembler::opcodeAt(int address) {
+  int offset = address - PROGRAM_START;
+  uint8_t high = offset >= 0 && offset < this->rom_size ? this->rom[offset] : 0;
+  uint8_t low = offset + 1 >= 0 && offset + 1 < this->rom_size ? this->rom[offset + 1] : 0;
+  return (high << 8) | low;
+}
+
+// only the part of the ROM that fits in memory can be executed, a longer
+// file's tail is listed as data
+bool Disassembler::inRom(int address) {
+  return address >= PROGRAM_START && address + 1 < std::min(PROGRAM_START + this->rom_size, MEM_SIZE);
+}
+
+void Disassembler::findBlocks(BlockIndex &index) {
+  std::memset(this->instruction_start, 0, sizeof(this->instruction_start));
+  std::memset(this->block_start, 0, sizeof(this->block_start));
+  // first every instruction reachable from the entry point, marking the
+  // places control arrives at other than by falling through
+  std::vector<uint16_t> pending(1, PROGRAM_START);
+  this->block_start[PROGRAM_START] = true;
+  while (!pending.empty()) {
+    uint16_t address = pending.back();
+    pending.pop_back();
+    while (this->inRom(address) && !this->instruction_start[address]) {
+      this->instruction_start[address] = true;
+      uint16_t opcode = this->opcodeAt(address);
+      int flow = flowOf(classify(opcode));
+      uint16_t next = address + OPCODE_SIZE;
+      if (flow == FLOW_NEXT) {
+        address = next;
+        continue;
+      }
+      uint16_t targets[2];
+      int count = 0;
+      if (flow == FLOW_JUMP || flow == FLOW_CALL) {
+        targets[count++] = opcode & 0x0FFF;
+      }
+      if (flow == FLOW_SKIP || flow == FLOW_CALL) {
+        targets[count++] = next;
+      }
+      if (flow == FLOW_SKIP) {
+        targets[count++] = next + OPCODE_SIZE;
+      }
+      for (int i = 0; i < count; i++) {
+        if (this->inRom(targets[i])) {
+          this->block_start[targets[i]] = true;
+          pending.push_back(targets[i]);
+        }
+      }
+      break;
+    }
+  }
+  // then the blocks, each running from one of those places up to the
+  // next one or to the first instruction that doesn't fall through
+  index.rom_size = this->rom_size;
+  index.rom_hash = BlockIndex::hashRom(this->rom, this->rom_size);
+  index.blocks.clear();
+  for (int start = PROGRAM_START; start < MEM_SIZE; start++) {
+    if (!this->block_start[start] || !this->instruction_start[start]) {
+      continue;
+    }
+    BlockIndex::Block block = {(uint16_t)start, 0, {}};
+    uint16_t address = start;
+    while (true) {
+      uint16_t opcode = this->opcodeAt(address);
+      uint16_t next = address + OPCODE_SIZE;
+      int flow = flowOf(classify(opcode));
+      block.length++;
+      if (flow == FLOW_JUMP || flow == FLOW_CALL) {
+        block.successors.push_back(opcode & 0x0FFF);
+      }
+      if (flow == FLOW_SKIP || flow == FLOW_CALL) {
+        block.successors.push_back(next);
+      }
+      if (flow == FLOW_SKIP) {
+        block.successors.push_back(next + OPCODE_SIZE);
+      }
+      if (flow != FLOW_NEXT || !this->inRom(next)) {
+        break;
+      }
+      if (this->block_start[next]) {
+        block.successors.push_back(next);
+        break;
+      }
+      address = next;
+    }
+    index.blocks.push_back(block);
+  }
+}
+
+// Lists the ROM in address order, a label before every block, and the
+// bytes between reachable instructions as data, eight to a line.
+int Disassembler::formatFlow(void) {
+  char *out = this->output;
+  int end = PROGRAM_START + this->rom_size;
+  int address = PROGRAM_START;
+  while (address < end) {
+    if (address < MEM_SIZE && this->instruction_start[address]) {
+      if (this->block_start[address]) {
+        out = appendLabel(out, address);
+        *out++ = ':';
+        *out++ = '\n';
+      }
+      uint16_t opcode = this->opcodeAt(address);
+      *out++ = ' ';
+      *out++ = ' ';
+      out = appendAddress(out, address);
+      *out++ = ' ';
+      *out++ = ' ';
+      const OpcodeFormat &format = findFormat(opcode);
+      if (format.mnemonic != NULL) {
+        out = appendInstruction(out, format, opcode, this->block_start);
+      } else {
+        // reached, but nothing the listing knows
+        std::memcpy(out, "DW  ", 4);
+        out = appendHex(out + 4, opcode, 4);
+        *out++ = '\n';
+      }
+      // an instruction starting inside this one gets its own line
+      address += this->instruction_start[address + 1] ? 1 : OPCODE_SIZE;
+      continue;
+    }
+    *out++ = ' ';
+    *out++ = ' ';
+    // four digits, the tail of a ROM too long for memory runs past 0xFFF
+    out = appendHex(out, address, 4);
+    std::memcpy(out, "  DB  ", 6);
+    out += 6;
+    for (int count = 0; address < end && count < 8 && (address >= MEM_SIZE || !this->instruction_start[address]); count++) {
+      if (count > 0) {
+        *out++ = ',';
+        *out++ = ' ';
+      }
+      out = appendHex(out, this->rom[address - PROGRAM_START], 2);
+      address++;
+    }
+    *out++ = '\n';
+  }
+  this->output_length = out - this->output;
+  return this->rom_size;
+}
\ No newline at end of file
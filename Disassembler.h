@@ -0,0 +1,81 @@
+#ifndef __DISASSEMBLER_
+#define __DISASSEMBLER_
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include "BlockIndex.h"
+#include "Chip8State.h"
+
+#define MEM_SIZE CHIP8_MEM_SIZE
+#define OPCODE_SIZE 2
+#define PROGRAM_START 0x200
+// room for a label and the longest line, "  0x0200  SPRITE  V15, V15, 15\n",
+// at every byte, since jumps to odd addresses can overlap instructions
+#define LINE_SIZE 40
+#define OUTPUT_SIZE (MEM_SIZE * LINE_SIZE)
+
+// what each word of a ROM decodes to: every instruction the listing
+// knows, then the ones it skips
+enum OpcodeKind {
+  KIND_00E0, KIND_00EE, KIND_1NNN, KIND_2NNN, KIND_3XNN, KIND_4XNN,
+  KIND_5XY0, KIND_6XNN, KIND_7XNN, KIND_8XY0, KIND_8XY1, KIND_8XY2,
+  KIND_8XY3, KIND_8XY4, KIND_8XY5, KIND_8XY6, KIND_8XY7, KIND_8XYE,
+  KIND_9XY0, KIND_ANNN, KIND_BNNN, KIND_CXNN, KIND_DXYN, KIND_EX9E,
+  KIND_EXA1, KIND_FX07, KIND_FX0A, KIND_FX15, KIND_FX18, KIND_FX1E,
+  KIND_FX29, KIND_FX33, KIND_FX55, KIND_FX65,
+  KIND_0000, // padding and the end of most listings
+  KIND_0NNN, // machine code calls, which no interpreter runs
+  KIND_SCHIP, // 00CN, 00FB-00FF, FX30, FX75 and FX85
+  KIND_UNKNOWN, KIND_COUNT
+};
+
+extern const char *const opcode_kind_names[KIND_COUNT];
+
+class Disassembler {
+  public:
+    Disassembler(void);
+    // exits if the game file can't be loaded
+    Disassembler(std::string filename);
+    // the bytes aren't copied and must outlive the disassembler
+    Disassembler(const uint8_t *rom, int size);
+    ~Disassembler(void);
+    // maps the game file instead of copying it
+    bool load(std::string filename);
+    // echo every opcode on stdout while disassembling
+    bool trace;
+    // follow jumps, calls and skips from 0x200 instead of sweeping from
+    // the first byte, label every basic block and list what no reachable
+    // instruction covers as data
+    bool flow;
+    // writes the listing next to the game file as name.chip8, and with
+    // flow the block index as name.blocks, -1 if either couldn't be written
+    int disassemble(void);
+    // returns the number of bytes consumed, up to and including the first
+    // 0x0000, otherwise (or with flow) the whole ROM
+    int disassemble(std::FILE *output_file);
+    // the basic blocks reachable from 0x200
+    void findBlocks(BlockIndex &index);
+    // adds the kind of every word of the ROM, past the first 0x0000 too
+    void count(uint64_t kinds[KIND_COUNT]);
+    int size(void);
+    static OpcodeKind classify(uint16_t opcode);
+  private:
+    const uint8_t *rom;
+    int rom_size;
+    void *mapping;
+    std::string filename;
+    bool instruction_start[MEM_SIZE]; // reachable instructions, set by findBlocks
+    bool block_start[MEM_SIZE];
+    BlockIndex blocks;
+    // a whole listing always fits, so it's written in one go
+    char output[OUTPUT_SIZE];
+    int output_length;
+    int format(void);
+    int formatFlow(void);
+    uint16_t opcodeAt(int address);
+    bool inRom(int address);
+    void unload(void);
+};
+
+#endif // __DISASSEMBLER_
\ No newline at end of file
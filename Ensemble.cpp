@@ -0,0 +1,545 @@
+#include "Ensemble.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+// every lane loop runs over the whole padded column, lanes outside the
+// current step are left unchanged through the mask. the bound is a local
+// copy of stride, byte stores could alias this->stride and keep the
+// compiler from vectorizing
+#define FOR_LANES(i) for (int i = 0; i < stride; i++)
+
+Ensemble::Ensemble(int lanes) {
+  this->lanes = lanes;
+  this->stride = (lanes + ENSEMBLE_LANE_ALIGN - 1) / ENSEMBLE_LANE_ALIGN * ENSEMBLE_LANE_ALIGN;
+  this->cycles_per_second = DEFAULT_CYCLES_PER_SECOND;
+  this->quirks = QUIRKS_MODERN;
+  this->step_function = &Ensemble::step<QUIRKS_MODERN>;
+  this->registers.assign(REGISTER_COUNT * this->stride, 0);
+  this->program_counter.assign(this->stride, INTERPRETER_SIZE);
+  this->index_register.assign(this->stride, 0);
+  this->delay_timer.assign(this->stride, 0);
+  this->sound_timer.assign(this->stride, 0);
+  this->timer_phase.assign(this->stride, 0);
+  this->screen.assign(this->lanes * SCREEN_HEIGHT, 0);
+  this->written.assign(MEM_SIZE, 0);
+  this->memory.assign((size_t)this->lanes * MEM_SIZE, 0);
+  this->stack.assign(this->lanes * STACK_SIZE, 0);
+  this->stack_ptr.assign(this->lanes, 0);
+  this->random_state.assign(this->lanes, 0);
+  this->keys.assign(this->lanes, 0);
+  // padding lanes count as finished so they never take part in a step
+  this->game_finished.assign(this->stride, 1);
+  std::fill(this->game_finished.begin(), this->game_finished.begin() + this->lanes, 0);
+  this->executed.assign(this->stride, 0);
+  this->cycle_count.assign(this->lanes, 0);
+  this->mask.assign(this->stride, 0);
+}
+
+bool Ensemble::loadGame(const char *name, uint32_t seed) {
+  // a scalar instance does the loading, so the fontset and ROM layout
+  // are exactly what Chip8 starts with
+  Chip8 *loader = new Chip8();
+  bool loaded = loader->loadGame(name);
+  if (loaded) {
+    for (int lane = 0; lane < this->lanes; lane++) {
+      std::memcpy(&this->memory[(size_t)lane * MEM_SIZE], loader->memory, MEM_SIZE);
+      loader->seedRandom(seed + lane);
+      this->random_state[lane] = loader->random_state;
+    }
+  }
+  delete loader;
+  return loaded;
+}
+
+void Ensemble::setClockSpeed(uint32_t cycles_per_second) {
+  this->cycles_per_second = cycles_per_second > 0 ? cycles_per_second : 1;
+  int stride = this->stride;
+  FOR_LANES(i) {
+    this->timer_phase[i] %= this->cycles_per_second;
+  }
+}
+
+void Ensemble::setQuirks(int profile) {
+  static void (Ensemble::*const step_functions[QUIRKS_COUNT])(uint16_t, uint16_t) = {
+    &Ensemble::step<QUIRKS_MODERN>, &Ensemble::step<QUIRKS_VIP>,
+    &Ensemble::step<QUIRKS_CHIP48>, &Ensemble::step<QUIRKS_SCHIP>
+  };
+  if (profile >= 0 && profile < QUIRKS_COUNT) {
+    this->quirks = profile;
+    this->step_function = step_functions[profile];
+  }
+}
+
+void Ensemble::setKeys(int lane, uint16_t keys) {
+  this->keys[lane] = keys;
+}
+
+bool Ensemble::finished(int lane) {
+  return this->game_finished[lane] != 0;
+}
+
+uint64_t Ensemble::cycles(int lane) {
+  return this->cycle_count[lane];
+}
+
+int Ensemble::size(void) {
+  return this->lanes;
+}
+
+void Ensemble::readLane(int lane, Chip8State &state) {
+  std::memset(&state, 0, sizeof(state));
+  std::memcpy(state.memory, &this->memory[(size_t)lane * MEM_SIZE], MEM_SIZE);
+  for (int i = 0; i < REGISTER_COUNT; i++) {
+    state.registers[i] = this->column(i)[lane];
+  }
+  state.program_counter = this->program_counter[lane];
+  state.index_register = this->index_register[lane];
+  state.delay_timer = this->delay_timer[lane];
+  state.sound_timer = this->sound_timer[lane];
+  std::memcpy(state.stack, &this->stack[lane * STACK_SIZE], sizeof(state.stack));
+  state.stack_ptr = this->stack_ptr[lane];
+  state.timer_phase = this->timer_phase[lane];
+  std::memcpy(state.screen, &this->screen[lane * SCREEN_HEIGHT], sizeof(state.screen));
+  state.random_state = this->random_state[lane];
+  uint16_t address = state.program_counter & 0xFFF;
+  state.current_opcode = (state.memory[address] << 8) | state.memory[(address + 1) & 0xFFF];
+}
+
+void Ensemble::runCycles(uint32_t count) {
+  std::fill(this->executed.begin(), this->executed.end(), 0);
+  uint16_t address;
+  uint16_t opcode;
+  while (this->selectLanes(count, address, opcode) > 0) {
+    (this->*step_function)(address, opcode);
+  }
+  for (int lane = 0; lane < this->lanes; lane++) {
+    this->cycle_count[lane] += this->executed[lane];
+  }
+}
+
+__attribute__((target_clones("avx2", "default")))
+int Ensemble::selectLanes(uint32_t count, uint16_t &address, uint16_t &opcode) {
+  int stride = this->stride;
+  const uint8_t *finished = this->game_finished.data();
+  const uint32_t *executed = this->executed.data();
+  const uint16_t *pc = this->program_counter.data();
+  uint8_t *m = this->mask.data();
+  // the lane furthest behind leads, so every lane keeps making progress
+  uint32_t least = count;
+  FOR_LANES(i) {
+    uint32_t behind = finished[i] ? count : executed[i];
+    least = behind < least ? behind : least;
+  }
+  if (least >= count) {
+    return 0;
+  }
+  int leader = 0;
+  while (finished[leader] || executed[leader] != least) {
+    leader++;
+  }
+  address = pc[leader] & 0xFFF;
+  uint16_t next = (address + 1) & 0xFFF;
+  const uint8_t *code = &this->memory[(size_t)leader * MEM_SIZE];
+  uint8_t high = code[address];
+  uint8_t low = code[next];
+  opcode = (high << 8) | low;
+  int selected = 0;
+  FOR_LANES(i) {
+    uint8_t same = !finished[i] & (executed[i] < count) & ((pc[i] & 0xFFF) == address);
+    m[i] = same;
+    selected += same;
+  }
+  // until some lane writes to these bytes every lane still holds the ROM
+  // there, so only the program counters have to match
+  if (this->written[address] || this->written[next]) {
+    for (int lane = 0; lane < this->lanes; lane++) {
+      code = &this->memory[(size_t)lane * MEM_SIZE];
+      if (m[lane] && (code[address] != high || code[next] != low)) {
+        m[lane] = 0;
+        selected--;
+      }
+    }
+  }
+  return selected;
+}
+
+template <int QUIRKS>
+__attribute__((target_clones("avx2", "default")))
+void Ensemble::step(uint16_t address, uint16_t opcode) {
+  int stride = this->stride;
+  uint8_t x = (opcode & 0x0F00) >> 8;
+  uint8_t y = (opcode & 0x00F0) >> 4;
+  uint8_t n = opcode & 0x000F;
+  uint8_t nn = opcode & 0x00FF;
+  uint16_t nnn = opcode & 0x0FFF;
+  const uint8_t *m = this->mask.data();
+  uint16_t *pc = this->program_counter.data();
+  uint16_t *index = this->index_register.data();
+  uint8_t *vx = this->column(x);
+  uint8_t *vy = this->column(y);
+  uint8_t *vf = this->column(0xF);
+  uint8_t *dt = this->delay_timer.data();
+  uint8_t *st = this->sound_timer.data();
+  // the fetch stores the program counter back wrapped to 12 bits
+  FOR_LANES(i) {
+    pc[i] = m[i] ? address : pc[i];
+  }
+  bool lane_wise = false;
+  switch (opcode >> 12) {
+    case 0x1:
+      FOR_LANES(i) {
+        pc[i] = m[i] ? nnn : pc[i];
+      }
+      break;
+    case 0x3:
+      FOR_LANES(i) {
+        uint8_t value = vx[i];
+        pc[i] += m[i] ? (value == nn ? 4 : 2) : 0;
+      }
+      break;
+    case 0x4:
+      FOR_LANES(i) {
+        uint8_t value = vx[i];
+        pc[i] += m[i] ? (value != nn ? 4 : 2) : 0;
+      }
+      break;
+    case 0x5:
+      FOR_LANES(i) {
+        uint8_t value1 = vx[i];
+        uint8_t value2 = vy[i];
+        pc[i] += m[i] ? (value1 == value2 ? 4 : 2) : 0;
+      }
+      break;
+    case 0x6:
+      FOR_LANES(i) {
+        vx[i] = m[i] ? nn : vx[i];
+        pc[i] += m[i] ? 2 : 0;
+      }
+      break;
+    case 0x7:
+      FOR_LANES(i) {
+        vx[i] += m[i] ? nn : 0;
+        pc[i] += m[i] ? 2 : 0;
+      }
+      break;
+    case 0x8:
+      // VF is written before VX is read back, as Chip8 does, so X or Y
+      // being F behaves the same
+      switch (n) {
+        case 0x0:
+          FOR_LANES(i) {
+            uint8_t value = vy[i];
+            vx[i] = m[i] ? value : vx[i];
+          }
+          break;
+        case 0x1:
+          FOR_LANES(i) {
+            uint8_t value = vy[i];
+            vx[i] |= m[i] ? value : 0;
+          }
+          break;
+        case 0x2:
+          FOR_LANES(i) {
+            uint8_t value = vy[i];
+            vx[i] &= m[i] ? value : 0xFF;
+          }
+          break;
+        case 0x3:
+          FOR_LANES(i) {
+            uint8_t value = vy[i];
+            vx[i] ^= m[i] ? value : 0;
+          }
+          break;
+        case 0x4:
+          FOR_LANES(i) {
+            uint8_t value1 = vx[i];
+            uint8_t value2 = vy[i];
+            vf[i] = m[i] ? (0x00FF - value1) < value2 : vf[i];
+            vx[i] += m[i] ? value2 : 0;
+          }
+          break;
+        case 0x5:
+          FOR_LANES(i) {
+            uint8_t value1 = vx[i];
+            uint8_t value2 = vy[i];
+            vf[i] = m[i] ? value1 > value2 : vf[i];
+            vx[i] -= m[i] ? value2 : 0;
+          }
+          break;
+        case 0x6:
+          if constexpr (quirk_profiles[QUIRKS].shift_vy) {
+            FOR_LANES(i) {
+              uint8_t value = vy[i];
+              vx[i] = m[i] ? value >> 1 : vx[i];
+              vf[i] = m[i] ? value & 0x01 : vf[i];
+            }
+          } else {
+            FOR_LANES(i) {
+              vf[i] = m[i] ? vx[i] & 0x01 : vf[i];
+              vx[i] = m[i] ? vx[i] >> 1 : vx[i];
+            }
+          }
+          break;
+        case 0x7:
+          FOR_LANES(i) {
+            uint8_t value1 = vx[i];
+            uint8_t value2 = vy[i];
+            vf[i] = m[i] ? value1 < value2 : vf[i];
+            vx[i] = m[i] ? value2 - value1 : vx[i];
+          }
+          break;
+        case 0xE:
+          if constexpr (quirk_profiles[QUIRKS].shift_vy) {
+            FOR_LANES(i) {
+              uint8_t value = vy[i];
+              vx[i] = m[i] ? value << 1 : vx[i];
+              vf[i] = m[i] ? value >> 7 : vf[i];
+            }
+          } else {
+            FOR_LANES(i) {
+              vf[i] = m[i] ? vx[i] >> 7 : vf[i];
+              vx[i] = m[i] ? vx[i] << 1 : vx[i];
+            }
+          }
+          break;
+      }
+      FOR_LANES(i) {
+        pc[i] += m[i] ? 2 : 0;
+      }
+      break;
+    case 0x9:
+      FOR_LANES(i) {
+        uint8_t value1 = vx[i];
+        uint8_t value2 = vy[i];
+        pc[i] += m[i] ? (value1 != value2 ? 4 : 2) : 0;
+      }
+      break;
+    case 0xA:
+      FOR_LANES(i) {
+        index[i] = m[i] ? nnn : index[i];
+        pc[i] += m[i] ? 2 : 0;
+      }
+      break;
+    case 0xF:
+      switch (nn) {
+        case 0x07:
+          FOR_LANES(i) {
+            uint8_t value = dt[i];
+            vx[i] = m[i] ? value : vx[i];
+          }
+          break;
+        case 0x15:
+          FOR_LANES(i) {
+            uint8_t value = vx[i];
+            dt[i] = m[i] ? value : dt[i];
+          }
+          break;
+        case 0x18:
+          FOR_LANES(i) {
+            uint8_t value = vx[i];
+            st[i] = m[i] ? value : st[i];
+          }
+          break;
+        case 0x1E:
+          FOR_LANES(i) {
+            uint8_t value = vx[i];
+            if constexpr (quirk_profiles[QUIRKS].index_overflow_flag) {
+              vf[i] = m[i] ? index[i] + value > 0xFFF : vf[i];
+            }
+            index[i] += m[i] ? value : 0;
+          }
+          break;
+        case 0x29:
+          FOR_LANES(i) {
+            uint16_t font = vx[i] * 0x5;
+            index[i] = m[i] ? font : index[i];
+          }
+          break;
+        default:
+          lane_wise = true;
+      }
+      if (!lane_wise) {
+        FOR_LANES(i) {
+          pc[i] += m[i] ? 2 : 0;
+        }
+      }
+      break;
+    default:
+      lane_wise = true;
+  }
+  if (lane_wise) {
+    for (int lane = 0; lane < this->lanes; lane++) {
+      if (m[lane]) {
+        this->stepLane<QUIRKS>(lane, opcode);
+      }
+    }
+  }
+  // the timers advance after every instruction, as in Chip8::updateTimers
+  uint32_t *phase = this->timer_phase.data();
+  uint32_t cycles_per_second = this->cycles_per_second;
+  if (cycles_per_second >= TIMER_FREQUENCY) {
+    // at most one tick per cycle
+    FOR_LANES(i) {
+      uint32_t advanced = phase[i] + (m[i] ? TIMER_FREQUENCY : 0);
+      bool tick = advanced >= cycles_per_second;
+      phase[i] = tick ? advanced - cycles_per_second : advanced;
+      dt[i] -= tick & (dt[i] > 0);
+      st[i] -= tick & (st[i] > 0);
+    }
+  } else {
+    for (int lane = 0; lane < this->lanes; lane++) {
+      if (!m[lane]) {
+        continue;
+      }
+      phase[lane] += TIMER_FREQUENCY;
+      while (phase[lane] >= cycles_per_second) {
+        phase[lane] -= cycles_per_second;
+        dt[lane] -= dt[lane] > 0;
+        st[lane] -= st[lane] > 0;
+      }
+    }
+  }
+  uint32_t *executed = this->executed.data();
+  FOR_LANES(i) {
+    executed[i] += m[i];
+  }
+}
+
+template <int QUIRKS>
+void Ensemble::stepLane(int lane, uint16_t opcode) {
+  uint8_t x = (opcode & 0x0F00) >> 8;
+  uint8_t n = opcode & 0x000F;
+  uint8_t nn = opcode & 0x00FF;
+  uint16_t nnn = opcode & 0x0FFF;
+  uint16_t &pc = this->program_counter[lane];
+  uint16_t &index = this->index_register[lane];
+  uint8_t *code = &this->memory[(size_t)lane * MEM_SIZE];
+  uint16_t *calls = &this->stack[lane * STACK_SIZE];
+  uint8_t &sp = this->stack_ptr[lane];
+  uint8_t &vx = this->column(x)[lane];
+  uint8_t &vf = this->column(0xF)[lane];
+  switch (opcode >> 12) {
+    case 0x0:
+      if (opcode == 0x0000) {
+        this->game_finished[lane] = 1;
+      } else if (opcode == 0x00E0) {
+        std::memset(&this->screen[lane * SCREEN_HEIGHT], 0, SCREEN_HEIGHT * sizeof(uint64_t));
+        pc += 2;
+      } else if (opcode == 0x00EE) {
+        pc = calls[--sp % STACK_SIZE] + 2;
+      } else {
+        pc += 2;
+      }
+      break;
+    case 0x2:
+      calls[sp % STACK_SIZE] = pc;
+      sp++;
+      pc = nnn;
+      break;
+    case 0xB:
+      pc = this->column(0)[lane] + nnn;
+      break;
+    case 0xC: {
+      uint32_t random = this->random_state[lane];
+      random ^= random << 13;
+      random ^= random >> 17;
+      random ^= random << 5;
+      this->random_state[lane] = random;
+      vx = (random % 0xFF) & nn;
+      pc += 2;
+      break;
+    }
+    case 0xD: {
+      // same blit as Chip8::opDXYN on one lane's screen
+      uint8_t sprite_x = vx;
+      uint8_t sprite_y = this->column((opcode & 0x00F0) >> 4)[lane];
+      vf = 0x0;
+      uint8_t shift = sprite_x % SCREEN_WIDTH;
+      uint64_t collision = 0;
+      uint64_t *pixel_rows = &this->screen[lane * SCREEN_HEIGHT];
+      if constexpr (quirk_profiles[QUIRKS].clip_sprites) {
+        uint8_t top = sprite_y % SCREEN_HEIGHT;
+        int rows = std::min(n, (uint8_t)(SCREEN_HEIGHT - top));
+        for (int yline = 0; yline < rows; yline++) {
+          uint64_t sprite = ((uint64_t)code[(index + yline) & 0xFFF] << (SCREEN_WIDTH - 8)) >> shift;
+          collision |= pixel_rows[top + yline] & sprite;
+          pixel_rows[top + yline] ^= sprite;
+        }
+      } else {
+        uint64_t first_row_mask = ~0ULL >> shift;
+        uint8_t row = (sprite_x / SCREEN_WIDTH + sprite_y) % SCREEN_HEIGHT;
+        for (int yline = 0; yline < n; yline++) {
+          uint64_t sprite = (uint64_t)code[(index + yline) & 0xFFF] << (SCREEN_WIDTH - 8);
+          sprite = (sprite >> shift) | (sprite << ((SCREEN_WIDTH - shift) % SCREEN_WIDTH));
+          uint8_t next_row = (row + 1) % SCREEN_HEIGHT;
+          uint64_t left = sprite & first_row_mask;
+          uint64_t right = sprite & ~first_row_mask;
+          uint64_t &pixels = pixel_rows[row];
+          uint64_t &next_pixels = pixel_rows[next_row];
+          collision |= (pixels & left) | (next_pixels & right);
+          pixels ^= left;
+          next_pixels ^= right;
+          row = next_row;
+        }
+      }
+      if (collision != 0) {
+        vf = 0x1;
+      }
+      pc += 2;
+      break;
+    }
+    case 0xE: {
+      bool pressed = vx < KEYS_COUNT && ((this->keys[lane] >> vx) & 1);
+      if (nn == 0x9E) {
+        pc += pressed ? 4 : 2;
+      } else if (nn == 0xA1) {
+        pc += pressed ? 2 : 4;
+      } else {
+        pc += 2;
+      }
+      break;
+    }
+    case 0xF:
+      switch (nn) {
+        case 0x0A:
+          // waits without advancing until a key is held
+          if (this->keys[lane] != 0) {
+            vx = __builtin_ctz(this->keys[lane]);
+            pc += 2;
+          }
+          return;
+        case 0x33:
+          this->written[index & 0xFFF] = 1;
+          this->written[(index + 1) & 0xFFF] = 1;
+          this->written[(index + 2) & 0xFFF] = 1;
+          code[index & 0xFFF] = vx / 100;
+          code[(index + 1) & 0xFFF] = (vx / 10) % 10;
+          code[(index + 2) & 0xFFF] = (vx % 100) % 10;
+          break;
+        case 0x55:
+          for (int i = 0; i <= x; i++) {
+            this->written[(index + i) & 0xFFF] = 1;
+            code[(index + i) & 0xFFF] = this->column(i)[lane];
+          }
+          if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X) {
+            index += x;
+          } else if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X_PLUS_1) {
+            index += x + 1;
+          }
+          break;
+        case 0x65:
+          for (int i = 0; i <= x; i++) {
+            this->column(i)[lane] = code[(index + i) & 0xFFF];
+          }
+          if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X) {
+            index += x;
+          } else if constexpr (quirk_profiles[QUIRKS].index_increment == INDEX_ADD_X_PLUS_1) {
+            index += x + 1;
+          }
+          break;
+      }
+      pc += 2;
+      break;
+  }
+}
\ No newline at end of file
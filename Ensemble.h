@@ -0,0 +1,72 @@
+#ifndef __ENSEMBLE_
+#define __ENSEMBLE_
+
+#include <stdint.h>
+#include <vector>
+#include "CPU.h"
+
+// lanes are padded to a multiple of this so every column is a whole
+// number of 256 bit vectors
+#define ENSEMBLE_LANE_ALIGN 32
+
+// Runs many instances of one ROM in lockstep. The state of every lane is
+// kept column-wise, register V0 of all lanes next to each other and so
+// on, and each step executes one instruction for every lane that sits at
+// the same address with the same opcode as the lane furthest behind.
+// Those lanes share the operand nibbles, so most opcodes turn into a
+// branch-free loop over whole columns that is compiled for AVX2 when the
+// CPU has it. Lanes that diverge simply wait for a later step.
+//
+// Results match Chip8::runCycles with virtual timers bit for bit.
+// Accesses past the end of memory or the stack wrap within the lane,
+// where Chip8 would write outside its arrays.
+class Ensemble {
+  public:
+    Ensemble(int lanes);
+    // loads the ROM into every lane, each lane is seeded with seed + lane
+    bool loadGame(const char *name, uint32_t seed);
+    void setClockSpeed(uint32_t cycles_per_second);
+    // one of the QUIRKS_* profiles, as Chip8::setQuirks
+    void setQuirks(int profile);
+    void setKeys(int lane, uint16_t keys);
+    // runs count cycles on every lane that hasn't finished
+    void runCycles(uint32_t count);
+    void readLane(int lane, Chip8State &state);
+    bool finished(int lane);
+    // cycles the lane has run over all calls to runCycles
+    uint64_t cycles(int lane);
+    int size(void);
+  private:
+    int lanes;
+    int stride; // lanes rounded up to ENSEMBLE_LANE_ALIGN
+    uint32_t cycles_per_second;
+    int quirks;
+    void (Ensemble::*step_function)(uint16_t address, uint16_t opcode);
+    // hot state, one column of stride entries per field
+    std::vector<uint8_t> registers; // REGISTER_COUNT columns
+    std::vector<uint16_t> program_counter;
+    std::vector<uint16_t> index_register;
+    std::vector<uint8_t> delay_timer;
+    std::vector<uint8_t> sound_timer;
+    std::vector<uint32_t> timer_phase;
+    // cold state, per lane
+    std::vector<uint64_t> screen; // SCREEN_HEIGHT rows per lane
+    std::vector<uint8_t> memory; // MEM_SIZE bytes per lane
+    std::vector<uint8_t> written; // addresses any lane has stored to
+    std::vector<uint16_t> stack; // STACK_SIZE entries per lane
+    std::vector<uint8_t> stack_ptr;
+    std::vector<uint32_t> random_state;
+    std::vector<uint16_t> keys;
+    std::vector<uint8_t> game_finished;
+    std::vector<uint32_t> executed; // cycles run in the current runCycles
+    std::vector<uint64_t> cycle_count;
+    std::vector<uint8_t> mask; // lanes taking part in the current step
+    uint8_t *column(int index) {
+      return &this->registers[index * this->stride];
+    }
+    int selectLanes(uint32_t count, uint16_t &address, uint16_t &opcode);
+    template <int QUIRKS> void step(uint16_t address, uint16_t opcode);
+    template <int QUIRKS> void stepLane(int lane, uint16_t opcode);
+};
+
+#endif // __ENSEMBLE_
\ No newline at end of file
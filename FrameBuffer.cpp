@@ -0,0 +1,27 @@
+#include "FrameBuffer.h"
+#include <cstring>
+
+#define FRESH_FRAME 0x4
+#define INDEX_MASK 0x3
+
+FrameBuffer::FrameBuffer(void) {
+  std::memset(this->frames, 0, sizeof(this->frames));
+  this->back = 0;
+  this->middle = 1;
+  this->front = 2;
+}
+
+void FrameBuffer::publish(const uint64_t *screen) {
+  std::memcpy(this->frames[this->back], screen, sizeof(this->frames[0]));
+  uint8_t previous = this->middle.exchange(this->back | FRESH_FRAME, std::memory_order_acq_rel);
+  this->back = previous & INDEX_MASK;
+}
+
+const uint64_t *FrameBuffer::acquire(void) {
+  if ((this->middle.load(std::memory_order_relaxed) & FRESH_FRAME) == 0) {
+    return NULL;
+  }
+  uint8_t previous = this->middle.exchange(this->front, std::memory_order_acq_rel);
+  this->front = previous & INDEX_MASK;
+  return this->frames[this->front];
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef __FRAME_BUFFER_
+#define __FRAME_BUFFER_
+
+#include <stdint.h>
+#include <atomic>
+#include "CPU.h"
+
+// Lock-free triple buffer that hands finished frames from the emulation
+// thread to the render thread. Neither side ever waits for the other and
+// the reader always gets the newest complete frame.
+class FrameBuffer {
+  public:
+    FrameBuffer(void);
+    // copies screen into the back buffer and makes it the newest frame
+    void publish(const uint64_t *screen);
+    // returns the newest frame, or NULL if none was published since the
+    // last call. The frame stays valid until the next call
+    const uint64_t *acquire(void);
+  private:
+    uint64_t frames[3][SCREEN_HEIGHT];
+    // index of the buffer between the two threads, FRESH_FRAME is set
+    // while it holds a frame the reader hasn't seen
+    std::atomic<uint8_t> middle;
+    uint8_t back; // only touched by the writer
+    uint8_t front; // only touched by the reader
+};
+
+#endif // __FRAME_BUFFER_
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef __FRONTEND_
+#define __FRONTEND_
+
+#include <stdint.h>
+#include <atomic>
+
+// Video, input and audio backend driven by Chip8::runEmu. The core never
+// calls into the frontend from runCycles, so batch runs pay nothing.
+class Frontend {
+  public:
+    virtual ~Frontend(void) {}
+    // screen holds SCREEN_HEIGHT rows of packed pixels, see SCREEN_PIXEL
+    virtual void drawScreen(const uint64_t *screen) = 0;
+    // starts publishing key state to keys from another thread, bit i is
+    // set while CHIP-8 key i is held
+    virtual void startInput(std::atomic<uint16_t> *keys) = 0;
+    virtual void stopInput(void) = 0;
+    // true while the player holds the key that steps back in time
+    virtual bool rewindHeld(void) {
+      return false;
+    }
+    virtual void setSound(bool on) = 0;
+};
+
+class NullFrontend : public Frontend {
+  public:
+    void drawScreen(const uint64_t *) {}
+    void startInput(std::atomic<uint16_t> *) {}
+    void stopInput(void) {}
+    void setSound(bool) {}
+};
+
+#endif // __FRONTEND_
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "InputLog.h"
+#include <cstdio>
+#include <cstring>
+
+static const char log_magic[4] = {'C', '8', 'I', 'N'};
+
+// integers are stored as little endian base 128 varints, events store
+// the cycles since the previous event so most take two or four bytes
+static void writeVarint(std::FILE *file, uint64_t value) {
+  while (value >= 0x80) {
+    std::fputc((value & 0x7F) | 0x80, file);
+    value >>= 7;
+  }
+  std::fputc(value, file);
+}
+
+static bool readVarint(std::FILE *file, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = std::fgetc(file);
+    if (byte == EOF) {
+      return false;
+    }
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+InputLog::InputLog(void) {
+  this->seed = 0;
+  this->cycles_per_second = 0;
+  this->timer_mode = 0;
+  this->quirks = 0;
+  this->end_cycle = 0;
+}
+
+void InputLog::addKeys(uint64_t cycle, uint16_t keys) {
+  Event event = {cycle, INPUT_EVENT_KEYS, keys};
+  this->events.push_back(event);
+}
+
+void InputLog::addTimerTick(uint64_t cycle) {
+  Event event = {cycle, INPUT_EVENT_TIMER_TICK, 0};
+  this->events.push_back(event);
+}
+
+bool InputLog::save(const char *name) {
+  std::FILE *file = std::fopen(name, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  std::fwrite(log_magic, 1, sizeof(log_magic), file);
+  writeVarint(file, INPUT_LOG_VERSION);
+  writeVarint(file, this->seed);
+  writeVarint(file, this->cycles_per_second);
+  writeVarint(file, this->timer_mode);
+  writeVarint(file, this->quirks);
+  writeVarint(file, this->end_cycle);
+  writeVarint(file, this->events.size());
+  uint64_t cycle = 0;
+  for (const Event &event : this->events) {
+    writeVarint(file, event.cycle - cycle);
+    std::fputc(event.type, file);
+    if (event.type == INPUT_EVENT_KEYS) {
+      writeVarint(file, event.keys);
+    }
+    cycle = event.cycle;
+  }
+  bool written = !std::ferror(file);
+  written &= std::fclose(file) == 0;
+  return written;
+}
+
+bool InputLog::load(const char *name) {
+  std::FILE *file = std::fopen(name, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  // parsed into locals, a truncated or corrupt log leaves this one empty
+  char magic[4];
+  uint64_t version = 0, seed = 0, cycles_per_second = 0, timer_mode = 0, quirks = 0, end_cycle = 0, count = 0;
+  bool valid = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+               std::memcmp(magic, log_magic, sizeof(magic)) == 0 &&
+               readVarint(file, version) && version >= 1 && version <= INPUT_LOG_VERSION &&
+               readVarint(file, seed) && readVarint(file, cycles_per_second) &&
+               readVarint(file, timer_mode) && (version < 2 || readVarint(file, quirks)) &&
+               readVarint(file, end_cycle) && readVarint(file, count);
+  std::vector<Event> events;
+  uint64_t cycle = 0;
+  for (uint64_t i = 0; valid && i < count; i++) {
+    uint64_t delta;
+    uint64_t keys = 0;
+    int type = EOF;
+    if (!readVarint(file, delta) || (type = std::fgetc(file)) == EOF ||
+        (type == INPUT_EVENT_KEYS && !readVarint(file, keys))) {
+      valid = false;
+      break;
+    }
+    cycle += delta;
+    Event event = {cycle, (uint8_t)type, (uint16_t)keys};
+    events.push_back(event);
+  }
+  std::fclose(file);
+  this->events.clear();
+  if (!valid) {
+    return false;
+  }
+  this->seed = seed;
+  this->cycles_per_second = cycles_per_second;
+  this->timer_mode = timer_mode;
+  this->quirks = quirks;
+  this->end_cycle = end_cycle;
+  this->events.swap(events);
+  return true;
+}
@@ -0,0 +1,36 @@
+#ifndef __INPUT_LOG_
+#define __INPUT_LOG_
+
+#include <stdint.h>
+#include <vector>
+
+// version 1 logs predate quirk profiles and replay as modern
+#define INPUT_LOG_VERSION 2
+#define INPUT_EVENT_KEYS 0
+#define INPUT_EVENT_TIMER_TICK 1
+
+// Everything a run depends on besides the ROM: the PRNG seed, the clock,
+// timer and quirk settings, and every key change and wall clock timer tick
+// keyed by the cycle count it happened at. Replaying it on the same ROM
+// reproduces the run bit for bit.
+class InputLog {
+  public:
+    struct Event {
+      uint64_t cycle;
+      uint8_t type;
+      uint16_t keys;
+    };
+    InputLog(void);
+    uint32_t seed;
+    uint32_t cycles_per_second;
+    int timer_mode;
+    int quirks;
+    uint64_t end_cycle; // cycle count when recording stopped
+    std::vector<Event> events;
+    void addKeys(uint64_t cycle, uint16_t keys);
+    void addTimerTick(uint64_t cycle);
+    bool save(const char *name);
+    bool load(const char *name);
+};
+
+#endif // __INPUT_LOG_
@@ -0,0 +1,403 @@
+#include "JIT.h"
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+
+// block exit kinds found while scanning
+#define OP_INLINE 0
+#define OP_HELPER 1
+#define OP_HELPER_END 2
+#define OP_JUMP 3
+#define OP_SKIP 4
+
+// x86-64 register fields used with [rbx + disp32] operands
+#define REG_RAX 0
+#define MODRM_RBX_DISP32(REG) (0x80 | ((REG) << 3) | 3)
+
+static int classifyOpcode(uint16_t opcode, bool &touches_timers) {
+  touches_timers = false;
+  switch (opcode >> 12) {
+    case 0x0:
+      if (opcode == 0x0000 || opcode == 0x00EE) {
+        return OP_HELPER_END;
+      }
+      return OP_HELPER;
+    case 0x1:
+      return OP_JUMP;
+    case 0x2:
+    case 0xB:
+    case 0xE:
+      return OP_HELPER_END;
+    case 0x3:
+    case 0x4:
+    case 0x5:
+    case 0x9:
+      return OP_SKIP;
+    case 0x6:
+    case 0x7:
+    case 0xA:
+      return OP_INLINE;
+    case 0x8:
+      return (opcode & 0x000F) <= 0x3 ? OP_INLINE : OP_HELPER;
+    case 0xF:
+      switch (opcode & 0x00FF) {
+        case 0x07:
+        case 0x15:
+        case 0x18:
+          touches_timers = true;
+          return OP_HELPER;
+        case 0x0A:
+        case 0x33:
+        case 0x55:
+          // key waits may not advance and stores may rewrite translated code
+          return OP_HELPER_END;
+      }
+      return OP_HELPER;
+  }
+  return OP_HELPER;
+}
+
+Jit::Jit(Chip8 *chip) {
+  this->chip = chip;
+  this->buffer = NULL;
+#if defined(__x86_64__)
+  void *memory = mmap(NULL, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory != MAP_FAILED) {
+    this->buffer = (uint8_t *)memory;
+  }
+#endif
+  this->cursor = this->buffer;
+  uint8_t *base = (uint8_t *)chip;
+  this->registers_offset = (uint8_t *)&chip->registers - base;
+  this->pc_offset = (uint8_t *)&chip->program_counter - base;
+  this->index_offset = (uint8_t *)&chip->index_register - base;
+  this->budget_offset = (uint8_t *)&chip->jit_budget - base;
+  this->draw_offset = (uint8_t *)&chip->should_draw - base;
+  std::memset(this->blocks, 0, sizeof(this->blocks));
+  std::memset(this->coverage, 0, sizeof(this->coverage));
+}
+
+Jit::~Jit(void) {
+  this->flush();
+  if (this->buffer != NULL) {
+    munmap(this->buffer, JIT_BUFFER_SIZE);
+  }
+}
+
+bool Jit::isAvailable(void) {
+  return this->buffer != NULL;
+}
+
+void Jit::step(Chip8 *chip) {
+  chip->executeDecoded();
+}
+
+uint32_t Jit::run(uint32_t count) {
+  uint32_t executed = 0;
+  while (executed < count && !this->chip->game_finished) {
+    uint16_t address = this->chip->program_counter & 0xFFF;
+    Block *block = this->blocks[address];
+    if (block == NULL) {
+      block = this->compile(address);
+    }
+    // timer reads and writes must not be reordered with a pending tick
+    if (block != NULL && (!block->touches_timers || (uint32_t)block->length <= this->chip->cyclesUntilTimerTick())) {
+      int32_t remaining = count - executed;
+      this->chip->jit_budget = remaining;
+      ((BlockEntry)block->entry)(this->chip);
+      uint32_t ran = remaining - this->chip->jit_budget;
+      if (ran > 0) {
+        this->chip->advanceTimers(ran);
+        executed += ran;
+        if (this->chip->idle_loop) {
+          executed += this->chip->skipIdleCycles(count - executed);
+        }
+        if (this->chip->should_draw) {
+          break;
+        }
+        continue;
+      }
+    }
+    // not enough budget left for the block, interpret a single cycle
+    this->chip->executeCycle();
+    executed++;
+    if (this->chip->idle_loop) {
+      executed += this->chip->skipIdleCycles(count - executed);
+    }
+    if (this->chip->should_draw) {
+      break;
+    }
+  }
+  return executed;
+}
+
+void Jit::warm(uint16_t start) {
+  if (this->blocks[start & 0xFFF] == NULL) {
+    this->compile(start & 0xFFF);
+  }
+}
+
+void Jit::invalidate(uint16_t address, int length) {
+  int first = std::max(address - 1, 0);
+  int last = std::min(address + length, MEM_SIZE);
+  bool covered = false;
+  for (int i = first; i < last; i++) {
+    if (this->coverage[i]) {
+      covered = true;
+      break;
+    }
+  }
+  if (!covered) {
+    return;
+  }
+  std::vector<Block *> stale;
+  for (Block *block : this->live_blocks) {
+    if (block->start < last && first < block->end) {
+      stale.push_back(block);
+    }
+  }
+  for (Block *block : stale) {
+    this->removeBlock(block);
+  }
+}
+
+void Jit::flush(void) {
+  for (Block *block : this->live_blocks) {
+    delete block;
+  }
+  this->live_blocks.clear();
+  for (int i = 0; i < MEM_SIZE; i++) {
+    this->links[i].clear();
+  }
+  std::memset(this->blocks, 0, sizeof(this->blocks));
+  std::memset(this->coverage, 0, sizeof(this->coverage));
+  this->cursor = this->buffer;
+}
+
+void Jit::removeBlock(Block *block) {
+  // send every chained jump into this block back to the dispatcher
+  for (uint8_t *site : this->links[block->start]) {
+    std::memset(site, 0, 4);
+  }
+  for (int i = block->start; i < block->end; i++) {
+    this->coverage[i]--;
+  }
+  this->blocks[block->start] = NULL;
+  this->live_blocks.erase(std::find(this->live_blocks.begin(), this->live_blocks.end(), block));
+  delete block;
+}
+
+void Jit::link(uint8_t *site, uint16_t target) {
+  target &= 0xFFF;
+  this->links[target].push_back(site);
+  Block *block = this->blocks[target];
+  if (block != NULL && !block->touches_timers) {
+    int32_t offset = block->chain_entry - (site + 4);
+    std::memcpy(site, &offset, 4);
+  }
+}
+
+Jit::Block *Jit::compile(uint16_t start) {
+  if (this->buffer + JIT_BUFFER_SIZE - this->cursor < 4096) {
+    this->flush();
+  }
+  // find the extent of the block first, its length is checked on entry
+  int32_t length = 0;
+  bool touches_timers = false;
+  uint16_t address = start;
+  int kind = OP_INLINE;
+  while (length < JIT_MAX_BLOCK_LENGTH && address + 1 < MEM_SIZE) {
+    uint16_t opcode = (this->chip->memory[address] << 8) | this->chip->memory[address + 1];
+    bool timers;
+    kind = classifyOpcode(opcode, timers);
+    if (kind == OP_JUMP && this->chip->isDelayLoop(address)) {
+      // leave timer polling loops to the interpreter so they can be skipped
+      kind = OP_HELPER_END;
+    }
+    touches_timers |= timers;
+    length++;
+    address += 2;
+    if (kind >= OP_HELPER_END) {
+      break;
+    }
+  }
+  if (length == 0) {
+    return NULL;
+  }
+  Block *block = new Block();
+  block->start = start;
+  block->end = address;
+  block->length = length;
+  block->touches_timers = touches_timers;
+  block->entry = this->cursor;
+  this->emit8(0x53); // push rbx
+  this->emit8(0x48); // mov rbx, rdi
+  this->emit8(0x89);
+  this->emit8(0xFB);
+  block->chain_entry = this->cursor;
+  std::vector<uint8_t *> bail_sites;
+  this->emitMem(0x80, 7, this->draw_offset); // cmp byte [should_draw], 0
+  this->emit8(0x00);
+  this->emit8(0x0F); // jne bail
+  this->emit8(0x85);
+  bail_sites.push_back(this->cursor);
+  this->emit32(0);
+  this->emitMem(0x81, 7, this->budget_offset); // cmp dword [budget], length
+  this->emit32(length);
+  this->emit8(0x0F); // jl bail
+  this->emit8(0x8C);
+  bail_sites.push_back(this->cursor);
+  this->emit32(0);
+  this->emitMem(0x81, 5, this->budget_offset); // sub dword [budget], length
+  this->emit32(length);
+  address = start;
+  for (int32_t i = 0; i < length; i++, address += 2) {
+    uint16_t opcode = (this->chip->memory[address] << 8) | this->chip->memory[address + 1];
+    bool timers;
+    kind = classifyOpcode(opcode, timers);
+    if (kind == OP_JUMP && this->chip->isDelayLoop(address)) {
+      kind = OP_HELPER_END;
+    }
+    int32_t vx = this->registers_offset + ((opcode & 0x0F00) >> 8);
+    int32_t vy = this->registers_offset + ((opcode & 0x00F0) >> 4);
+    uint8_t nn = opcode & 0x00FF;
+    switch (kind) {
+      case OP_INLINE:
+        switch (opcode >> 12) {
+          case 0x6:
+            this->emitMem(0xC6, 0, vx); // mov byte [vx], nn
+            this->emit8(nn);
+            break;
+          case 0x7:
+            this->emitMem(0x80, 0, vx); // add byte [vx], nn
+            this->emit8(nn);
+            break;
+          case 0x8: {
+            static const uint8_t alu_ops[] = { 0x88, 0x08, 0x20, 0x30 }; // mov, or, and, xor
+            this->emitMem(0x8A, REG_RAX, vy); // mov al, [vy]
+            this->emitMem(alu_ops[opcode & 0x000F], REG_RAX, vx); // op [vx], al
+            break;
+          }
+          case 0xA:
+            this->emit8(0x66); // mov word [index_register], nnn
+            this->emitMem(0xC7, 0, this->index_offset);
+            this->emit16(opcode & 0x0FFF);
+            break;
+        }
+        break;
+      case OP_HELPER:
+        this->emitHelperCall(address);
+        break;
+      case OP_HELPER_END:
+        this->emitHelperCall(address);
+        this->emitReturn();
+        break;
+      case OP_JUMP:
+        this->emitExit(opcode & 0x0FFF);
+        break;
+      case OP_SKIP: {
+        uint8_t condition;
+        switch (opcode >> 12) {
+          case 0x3:
+          case 0x4:
+            this->emitMem(0x80, 7, vx); // cmp byte [vx], nn
+            this->emit8(nn);
+            condition = (opcode >> 12) == 0x3 ? 0x84 : 0x85; // je / jne
+            break;
+          default:
+            this->emitMem(0x8A, REG_RAX, vx); // mov al, [vx]
+            this->emitMem(0x3A, REG_RAX, vy); // cmp al, [vy]
+            condition = (opcode >> 12) == 0x5 ? 0x84 : 0x85;
+        }
+        this->emit8(0x0F);
+        this->emit8(condition);
+        uint8_t *skip_site = this->cursor;
+        this->emit32(0);
+        this->emitExit(address + 2);
+        int32_t offset = this->cursor - (skip_site + 4);
+        std::memcpy(skip_site, &offset, 4);
+        this->emitExit(address + 4);
+        break;
+      }
+    }
+  }
+  if (kind == OP_INLINE || kind == OP_HELPER) {
+    // the block was cut short, fall through to the next instruction
+    this->emitExit(address);
+  }
+  for (uint8_t *site : bail_sites) {
+    int32_t offset = this->cursor - (site + 4);
+    std::memcpy(site, &offset, 4);
+  }
+  this->emitReturn();
+  this->blocks[start] = block;
+  this->live_blocks.push_back(block);
+  for (int i = block->start; i < block->end; i++) {
+    this->coverage[i]++;
+  }
+  if (!touches_timers) {
+    for (uint8_t *site : this->links[start]) {
+      int32_t offset = block->chain_entry - (site + 4);
+      std::memcpy(site, &offset, 4);
+    }
+  }
+  return block;
+}
+
+void Jit::emit8(uint8_t value) {
+  *this->cursor++ = value;
+}
+
+void Jit::emit16(uint16_t value) {
+  std::memcpy(this->cursor, &value, 2);
+  this->cursor += 2;
+}
+
+void Jit::emit32(uint32_t value) {
+  std::memcpy(this->cursor, &value, 4);
+  this->cursor += 4;
+}
+
+void Jit::emit64(uint64_t value) {
+  std::memcpy(this->cursor, &value, 8);
+  this->cursor += 8;
+}
+
+void Jit::emitMem(uint8_t opcode, uint8_t reg, int32_t offset) {
+  this->emit8(opcode);
+  this->emit8(MODRM_RBX_DISP32(reg));
+  this->emit32(offset);
+}
+
+void Jit::emitHelperCall(uint16_t address) {
+  this->emit8(0x66); // mov word [program_counter], address
+  this->emitMem(0xC7, 0, this->pc_offset);
+  this->emit16(address);
+  this->emit8(0x48); // mov rdi, rbx
+  this->emit8(0x89);
+  this->emit8(0xDF);
+  this->emit8(0x48); // mov rax, Jit::step
+  this->emit8(0xB8);
+  this->emit64((uint64_t)&Jit::step);
+  this->emit8(0xFF); // call rax
+  this->emit8(0xD0);
+}
+
+void Jit::emitExit(uint16_t target) {
+  this->emit8(0x66); // mov word [program_counter], target
+  this->emitMem(0xC7, 0, this->pc_offset);
+  this->emit16(target);
+  // jmp rel32, initially to the return below and patched once the
+  // target block has been translated
+  this->emit8(0xE9);
+  uint8_t *site = this->cursor;
+  this->emit32(0);
+  this->emitReturn();
+  this->link(site, target);
+}
+
+void Jit::emitReturn(void) {
+  this->emit8(0x5B); // pop rbx
+  this->emit8(0xC3); // ret
+}
\ No newline at end of file
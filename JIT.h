@@ -0,0 +1,61 @@
+#ifndef __JIT_
+#define __JIT_
+
+#include <stdint.h>
+#include <vector>
+#include "CPU.h"
+
+#define JIT_BUFFER_SIZE (1024 * 1024)
+#define JIT_MAX_BLOCK_LENGTH 64
+
+// Translates basic blocks of CHIP-8 code into x86-64 machine code.
+// Simple register opcodes are emitted inline, everything else calls back
+// into the interpreter's decoded handlers. Blocks that end with a static
+// jump or skip are chained directly to their successors.
+class Jit {
+  public:
+    Jit(Chip8 *chip);
+    ~Jit(void);
+    bool isAvailable(void);
+    uint32_t run(uint32_t count);
+    void invalidate(uint16_t address, int length);
+    // translates the block at start now rather than on its first run
+    void warm(uint16_t start);
+    void flush(void);
+  private:
+    typedef void (*BlockEntry)(Chip8 *chip);
+    struct Block {
+      uint16_t start;
+      uint16_t end; // one past the last byte
+      int32_t length; // in instructions
+      bool touches_timers;
+      uint8_t *entry;
+      uint8_t *chain_entry;
+    };
+    Chip8 *chip;
+    uint8_t *buffer;
+    uint8_t *cursor;
+    Block *blocks[MEM_SIZE];
+    std::vector<Block *> live_blocks;
+    std::vector<uint8_t *> links[MEM_SIZE]; // rel32 jumps waiting for a block
+    uint8_t coverage[MEM_SIZE]; // live blocks covering each byte
+    int32_t registers_offset;
+    int32_t pc_offset;
+    int32_t index_offset;
+    int32_t budget_offset;
+    int32_t draw_offset;
+    static void step(Chip8 *chip);
+    Block *compile(uint16_t start);
+    void removeBlock(Block *block);
+    void link(uint8_t *site, uint16_t target);
+    void emit8(uint8_t value);
+    void emit16(uint16_t value);
+    void emit32(uint32_t value);
+    void emit64(uint64_t value);
+    void emitMem(uint8_t opcode, uint8_t reg, int32_t offset);
+    void emitHelperCall(uint16_t address);
+    void emitExit(uint16_t target);
+    void emitReturn(void);
+};
+
+#endif // __JIT_
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "Profile.h"
+#include <cstring>
+#include <algorithm>
+
+static const char *class_names[PROFILE_CLASS_COUNT] = {
+  "00E0", "00EE", "0NNN", "1NNN", "2NNN",
+  "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+  "8XY0", "8XY1", "8XY2", "8XY3", "8XY4",
+  "8XY5", "8XY6", "8XY7", "8XYE", "9XY0",
+  "ANNN", "BNNN", "CXNN", "DXYN", "EX9E",
+  "EXA1", "FX07", "FX0A", "FX15", "FX18",
+  "FX1E", "FX29", "FX33", "FX55", "FX65",
+  "unknown"
+};
+
+Profile::Profile(void) {
+  this->reset();
+}
+
+void Profile::reset(void) {
+  std::memset(this->classes, 0, sizeof(this->classes));
+  std::memset(this->addresses, 0, sizeof(this->addresses));
+  this->key_wait_cycles = 0;
+}
+
+// follows the decoding of Chip8::decodeInstruction, 5XYN counts as 5XY0
+ProfileClass Profile::classify(uint16_t opcode) {
+  switch (opcode >> 12) {
+    case 0x0:
+      if (opcode == 0x00E0) {
+        return PROFILE_00E0;
+      }
+      return opcode == 0x00EE ? PROFILE_00EE : PROFILE_0NNN;
+    case 0x1: return PROFILE_1NNN;
+    case 0x2: return PROFILE_2NNN;
+    case 0x3: return PROFILE_3XNN;
+    case 0x4: return PROFILE_4XNN;
+    case 0x5: return PROFILE_5XY0;
+    case 0x6: return PROFILE_6XNN;
+    case 0x7: return PROFILE_7XNN;
+    case 0x8:
+      switch (opcode & 0x000F) {
+        case 0x0: return PROFILE_8XY0;
+        case 0x1: return PROFILE_8XY1;
+        case 0x2: return PROFILE_8XY2;
+        case 0x3: return PROFILE_8XY3;
+        case 0x4: return PROFILE_8XY4;
+        case 0x5: return PROFILE_8XY5;
+        case 0x6: return PROFILE_8XY6;
+        case 0x7: return PROFILE_8XY7;
+        case 0xE: return PROFILE_8XYE;
+      }
+      return PROFILE_UNKNOWN;
+    case 0x9: return PROFILE_9XY0;
+    case 0xA: return PROFILE_ANNN;
+    case 0xB: return PROFILE_BNNN;
+    case 0xC: return PROFILE_CXNN;
+    case 0xD: return PROFILE_DXYN;
+    case 0xE:
+      if ((opcode & 0x00FF) == 0x9E) {
+        return PROFILE_EX9E;
+      }
+      return (opcode & 0x00FF) == 0xA1 ? PROFILE_EXA1 : PROFILE_UNKNOWN;
+  }
+  switch (opcode & 0x00FF) {
+    case 0x07: return PROFILE_FX07;
+    case 0x0A: return PROFILE_FX0A;
+    case 0x15: return PROFILE_FX15;
+    case 0x18: return PROFILE_FX18;
+    case 0x1E: return PROFILE_FX1E;
+    case 0x29: return PROFILE_FX29;
+    case 0x33: return PROFILE_FX33;
+    case 0x55: return PROFILE_FX55;
+    case 0x65: return PROFILE_FX65;
+  }
+  return PROFILE_UNKNOWN;
+}
+
+static double share(uint64_t count, uint64_t total) {
+  return total > 0 ? 100.0 * count / total : 0;
+}
+
+void Profile::write(std::FILE *out, const uint8_t *memory) {
+  uint64_t total = 0;
+  for (int i = 0; i < PROFILE_CLASS_COUNT; i++) {
+    total += this->classes[i];
+  }
+  std::fprintf(out, "cycles: %llu\n", (unsigned long long)total);
+  std::fprintf(out, "draws: %llu\n", (unsigned long long)this->classes[PROFILE_DXYN]);
+  std::fprintf(out, "clears: %llu\n", (unsigned long long)this->classes[PROFILE_00E0]);
+  std::fprintf(out, "key wait cycles: %llu (%.1f%%)\n", (unsigned long long)this->key_wait_cycles,
+               share(this->key_wait_cycles, total));
+  int order[PROFILE_CLASS_COUNT];
+  for (int i = 0; i < PROFILE_CLASS_COUNT; i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order, order + PROFILE_CLASS_COUNT, [this](int a, int b) {
+    return this->classes[a] > this->classes[b];
+  });
+  std::fprintf(out, "\nopcode    count           share\n");
+  for (int i = 0; i < PROFILE_CLASS_COUNT && this->classes[order[i]] > 0; i++) {
+    uint64_t count = this->classes[order[i]];
+    std::fprintf(out, "%-9s %-15llu %5.1f%%\n", class_names[order[i]], (unsigned long long)count, share(count, total));
+  }
+  // the hottest addresses, highest count first
+  int hot[PROFILE_MEM_SIZE];
+  for (int i = 0; i < PROFILE_MEM_SIZE; i++) {
+    hot[i] = i;
+  }
+  int shown = std::min(PROFILE_HOT_ADDRESSES, PROFILE_MEM_SIZE);
+  std::partial_sort(hot, hot + shown, hot + PROFILE_MEM_SIZE, [this](int a, int b) {
+    return this->addresses[a] > this->addresses[b] || (this->addresses[a] == this->addresses[b] && a < b);
+  });
+  std::fprintf(out, "\naddress   opcode  count           share\n");
+  for (int i = 0; i < shown && this->addresses[hot[i]] > 0; i++) {
+    int address = hot[i];
+    uint16_t opcode = (memory[address] << 8) | memory[(address + 1) % PROFILE_MEM_SIZE];
+    std::fprintf(out, "0x%.3X     %.4X    %-15llu %5.1f%%\n", address, opcode,
+                 (unsigned long long)this->addresses[address], share(this->addresses[address], total));
+  }
+}
\ No newline at end of file
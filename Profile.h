@@ -0,0 +1,49 @@
+#ifndef __PROFILE_
+#define __PROFILE_
+
+#include <stdint.h>
+#include <cstdio>
+
+// build with -DPROFILE=1 (make PROFILE=1) to count every executed cycle,
+// the default build compiles all of the counting out
+#ifndef PROFILE
+#define PROFILE 0
+#endif
+
+#define PROFILE_MEM_SIZE 4096
+#define PROFILE_HOT_ADDRESSES 20
+
+// opcode classes, one per instruction of the CHIP-8 set
+enum ProfileClass {
+  PROFILE_00E0, PROFILE_00EE, PROFILE_0NNN, PROFILE_1NNN, PROFILE_2NNN,
+  PROFILE_3XNN, PROFILE_4XNN, PROFILE_5XY0, PROFILE_6XNN, PROFILE_7XNN,
+  PROFILE_8XY0, PROFILE_8XY1, PROFILE_8XY2, PROFILE_8XY3, PROFILE_8XY4,
+  PROFILE_8XY5, PROFILE_8XY6, PROFILE_8XY7, PROFILE_8XYE, PROFILE_9XY0,
+  PROFILE_ANNN, PROFILE_BNNN, PROFILE_CXNN, PROFILE_DXYN, PROFILE_EX9E,
+  PROFILE_EXA1, PROFILE_FX07, PROFILE_FX0A, PROFILE_FX15, PROFILE_FX18,
+  PROFILE_FX1E, PROFILE_FX29, PROFILE_FX33, PROFILE_FX55, PROFILE_FX65,
+  PROFILE_UNKNOWN, PROFILE_CLASS_COUNT
+};
+
+// Execution counts of one Chip8. Only the interpreter counts, so a
+// profiling build runs every cycle through it.
+struct Profile {
+  uint64_t classes[PROFILE_CLASS_COUNT];
+  uint64_t addresses[PROFILE_MEM_SIZE]; // cycles started at each address
+  uint64_t key_wait_cycles; // FX0A cycles spent without a key
+  Profile(void);
+  void reset(void);
+  static ProfileClass classify(uint16_t opcode);
+  void count(uint16_t address, uint16_t opcode, bool stalled, uint64_t times = 1) {
+    ProfileClass type = classify(opcode);
+    this->classes[type] += times;
+    this->addresses[address] += times;
+    if (type == PROFILE_FX0A && stalled) {
+      this->key_wait_cycles += times;
+    }
+  }
+  // memory gives the opcode shown next to each hot address
+  void write(std::FILE *out, const uint8_t *memory);
+};
+
+#endif // __PROFILE_
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef __QUIRKS_
+#define __QUIRKS_
+
+#include <stdint.h>
+#include <cstring>
+
+// compatibility profiles, modern is what this emulator has always done
+#define QUIRKS_MODERN 0
+#define QUIRKS_VIP 1
+#define QUIRKS_CHIP48 2
+#define QUIRKS_SCHIP 3
+#define QUIRKS_COUNT 4
+
+// how far FX55/FX65 move I past the registers they store or load
+#define INDEX_KEEP 0
+#define INDEX_ADD_X 1
+#define INDEX_ADD_X_PLUS_1 2
+
+// Behaviour that differs between CHIP-8 interpreters of different eras.
+// The cores are templated on a profile index, so each of these turns into
+// straight-line code in its own instantiation instead of a branch.
+struct QuirkProfile {
+  const char *name;
+  bool shift_vy; // 8XY6/8XYE shift VY into VX rather than VX in place
+  uint8_t index_increment; // INDEX_KEEP, INDEX_ADD_X or INDEX_ADD_X_PLUS_1
+  bool clip_sprites; // DXYN drops pixels past the edges instead of wrapping
+  bool index_overflow_flag; // FX1E sets VF when I passes 0xFFF
+};
+
+inline constexpr QuirkProfile quirk_profiles[QUIRKS_COUNT] = {
+  {"modern", false, INDEX_KEEP, false, true},
+  {"vip", true, INDEX_ADD_X_PLUS_1, true, false},
+  {"chip48", false, INDEX_ADD_X, true, false},
+  {"schip", false, INDEX_KEEP, true, false}
+};
+
+// returns the profile called name, or -1
+inline int findQuirks(const char *name) {
+  for (int i = 0; i < QUIRKS_COUNT; i++) {
+    if (std::strcmp(quirk_profiles[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+#endif // __QUIRKS_
\ No newline at end of file
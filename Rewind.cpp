@@ -0,0 +1,127 @@
+#include "Rewind.h"
+#include <cstring>
+
+// encoded frames are a list of runs, each a byte with the number of
+// unchanged bytes, a byte with the number of changed bytes and then the
+// changed bytes XORed with the base
+#define MAX_RUN 255
+
+Rewind::Rewind(size_t size) {
+  this->buffer.resize(size);
+  // every run covers at least one byte and alternating bytes cost three
+  // bytes per two, so twice the state size always fits
+  this->scratch.resize(2 * sizeof(Chip8State));
+  this->frames_since_keyframe = REWIND_KEYFRAME_INTERVAL;
+  std::memset(&this->keyframe_state, 0, sizeof(Chip8State));
+}
+
+uint32_t Rewind::encode(const uint8_t *state, const uint8_t *base) {
+  uint8_t *out = this->scratch.data();
+  size_t i = 0;
+  while (i < sizeof(Chip8State)) {
+    uint8_t same = 0;
+    while (i < sizeof(Chip8State) && same < MAX_RUN && state[i] == base[i]) {
+      same++;
+      i++;
+    }
+    uint8_t changed = 0;
+    uint8_t *header = out;
+    out += 2;
+    while (i < sizeof(Chip8State) && changed < MAX_RUN && state[i] != base[i]) {
+      *out++ = state[i] ^ base[i];
+      changed++;
+      i++;
+    }
+    header[0] = same;
+    header[1] = changed;
+  }
+  return out - this->scratch.data();
+}
+
+void Rewind::decode(const Entry &entry, uint8_t *state) {
+  const uint8_t *in = &this->buffer[entry.offset];
+  const uint8_t *end = in + entry.length;
+  size_t i = 0;
+  while (in < end) {
+    i += in[0];
+    uint8_t changed = in[1];
+    in += 2;
+    for (uint8_t j = 0; j < changed; j++) {
+      state[i++] ^= *in++;
+    }
+  }
+}
+
+uint8_t *Rewind::allocate(uint32_t length, bool keyframe) {
+  size_t start = 0;
+  if (!this->entries.empty()) {
+    start = this->entries.back().offset + this->entries.back().length;
+  }
+  if (start + length > this->buffer.size()) {
+    // wrap around, whatever sits past the newest frame is the oldest
+    while (!this->entries.empty() && this->entries.front().offset >= start) {
+      this->entries.pop_front();
+    }
+    start = 0;
+  }
+  while (!this->entries.empty() && this->entries.front().offset < start + length &&
+         this->entries.front().offset + this->entries.front().length > start) {
+    this->entries.pop_front();
+  }
+  // frames can't be decoded without their keyframe
+  while (!this->entries.empty() && !this->entries.front().keyframe) {
+    this->entries.pop_front();
+  }
+  if (!keyframe && this->entries.empty()) {
+    return NULL;
+  }
+  Entry entry = {start, length, keyframe};
+  this->entries.push_back(entry);
+  return &this->buffer[start];
+}
+
+void Rewind::record(const Chip8State &state) {
+  const uint8_t *bytes = (const uint8_t *)&state;
+  if (this->frames_since_keyframe < REWIND_KEYFRAME_INTERVAL) {
+    uint32_t length = this->encode(bytes, (const uint8_t *)&this->keyframe_state);
+    uint8_t *out = this->allocate(length, false);
+    if (out != NULL) {
+      std::memcpy(out, this->scratch.data(), length);
+      this->frames_since_keyframe++;
+      return;
+    }
+    // the ring is too small to hold the keyframe and this frame
+  }
+  static const Chip8State zero = {};
+  uint32_t length = this->encode(bytes, (const uint8_t *)&zero);
+  if (length > this->buffer.size()) {
+    return;
+  }
+  std::memcpy(this->allocate(length, true), this->scratch.data(), length);
+  this->keyframe_state = state;
+  this->frames_since_keyframe = 1;
+}
+
+bool Rewind::stepBack(Chip8State &state) {
+  if (this->entries.size() < 2) {
+    return false;
+  }
+  this->entries.pop_back();
+  size_t keyframe = this->entries.size() - 1;
+  while (!this->entries[keyframe].keyframe) {
+    keyframe--;
+  }
+  uint8_t *bytes = (uint8_t *)&state;
+  std::memset(bytes, 0, sizeof(Chip8State));
+  this->decode(this->entries[keyframe], bytes);
+  if (keyframe != this->entries.size() - 1) {
+    this->decode(this->entries.back(), bytes);
+  }
+  // recording resumes with a fresh keyframe
+  this->frames_since_keyframe = REWIND_KEYFRAME_INTERVAL;
+  return true;
+}
+
+int Rewind::frameCount(void) {
+  return this->entries.size();
+}
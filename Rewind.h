@@ -0,0 +1,41 @@
+#ifndef __REWIND_
+#define __REWIND_
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "CPU.h"
+
+#define REWIND_BUFFER_SIZE (4 * 1024 * 1024)
+#define REWIND_KEYFRAME_INTERVAL 60
+
+// Keeps the recent history of a Chip8 in a fixed size ring of bytes.
+// Every REWIND_KEYFRAME_INTERVAL frames a keyframe is stored, the frames
+// in between are stored as the XOR against that keyframe, run length
+// encoded so unchanged bytes cost next to nothing. The oldest frames are
+// dropped when the ring is full.
+class Rewind {
+  public:
+    Rewind(size_t size = REWIND_BUFFER_SIZE);
+    void record(const Chip8State &state);
+    // drops the newest frame and restores the one before it into state,
+    // returns false once there is no older frame
+    bool stepBack(Chip8State &state);
+    int frameCount(void);
+  private:
+    struct Entry {
+      size_t offset;
+      uint32_t length;
+      bool keyframe;
+    };
+    std::vector<uint8_t> buffer;
+    std::deque<Entry> entries;
+    Chip8State keyframe_state;
+    int frames_since_keyframe;
+    std::vector<uint8_t> scratch;
+    uint32_t encode(const uint8_t *state, const uint8_t *base);
+    void decode(const Entry &entry, uint8_t *state);
+    uint8_t *allocate(uint32_t length, bool keyframe);
+};
+
+#endif // __REWIND_
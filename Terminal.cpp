@@ -0,0 +1,174 @@
+#include "Terminal.h"
+#include "CPU.h"
+#include <cstring>
+#include <cstdio>
+#include <ncurses.h>
+#include <unistd.h>
+#include <poll.h>
+#include <chrono>
+
+#define WHITE_COLOR 1
+#define BLACK_COLOR 2
+#define CHANGE_COLOR(COLOR) attron(COLOR_PAIR(COLOR))
+// terminals send no key release events, a key counts as held while it
+// keeps repeating and as released after this long without input. It has
+// to outlast the autorepeat delay (commonly 250-600 ms) or a held key
+// drops out before the repeats start and games see it pressed twice, the
+// price is that a single tap stays down this long
+#define RELEASE_MS 500
+#define INPUT_POLL_MS 10
+// backspace steps back while rewinding is enabled
+#define REWIND_KEY 0x7F
+#define REWIND_BIT (1 << KEYS_COUNT)
+
+static const char keyboard[] = {
+  '1', '2', '3', '4',
+  'q', 'w', 'e', 'r',
+  'a', 's', 'd', 'f',
+  'z', 'x', 'c', 'v'
+};
+
+TerminalFrontend::TerminalFrontend(void) {
+  this->input_running = false;
+  this->rewind_held = false;
+  this->sound_on = false;
+  this->full_redraw = true;
+  this->current_color = -1;
+  std::memset(this->presented, 0, sizeof(this->presented));
+  initscr();
+  cbreak();
+  noecho();
+  start_color();
+  init_pair(WHITE_COLOR, COLOR_BLACK, COLOR_WHITE);
+  init_pair(BLACK_COLOR, COLOR_WHITE, COLOR_BLACK);
+  timeout(0);
+}
+
+TerminalFrontend::~TerminalFrontend(void) {
+  this->stopInput();
+  endwin();
+}
+
+void TerminalFrontend::drawScreen(const uint64_t *screen) {
+  // the terminal keeps the last presented frame, only runs of pixels that
+  // changed since then are written, one call per run of the same color
+  static const char spaces[SCREEN_WIDTH * 2 + 1] = "                                                                                                                                ";
+  for (int y = 0; y < SCREEN_HEIGHT; y++) {
+    uint64_t changed = screen[y] ^ this->presented[y];
+    if (this->full_redraw) {
+      changed = ~0ULL;
+    }
+    int x = 0;
+    while (changed != 0) {
+      // skip to the next changed pixel
+      int skip = __builtin_clzll(changed);
+      x += skip;
+      changed <<= skip;
+      int color = SCREEN_PIXEL(screen, x, y);
+      int length = 0;
+      while (x + length < SCREEN_WIDTH && (changed >> 63) && (int)SCREEN_PIXEL(screen, x + length, y) == color) {
+        changed <<= 1;
+        length++;
+      }
+      if (color != this->current_color) {
+        CHANGE_COLOR(color ? WHITE_COLOR : BLACK_COLOR);
+        this->current_color = color;
+      }
+      mvaddnstr(y, x * 2, spaces, length * 2);
+      x += length;
+    }
+    this->presented[y] = screen[y];
+  }
+  this->full_redraw = false;
+  refresh();
+}
+
+void HalfBlockFrontend::drawScreen(const uint64_t *screen) {
+  if (!this->full_redraw && std::memcmp(screen, this->presented, sizeof(this->presented)) == 0) {
+    return;
+  }
+  // indexed by top pixel | bottom pixel << 1
+  static const char *glyphs[] = {" ", "\u2580", "\u2584", "\u2588"};
+  static const int glyph_lengths[] = {1, 3, 3, 3};
+  char *cursor = this->frame;
+  for (int row = 0; row < SCREEN_HEIGHT / 2; row++) {
+    uint64_t top = screen[row * 2];
+    uint64_t bottom = screen[row * 2 + 1];
+    if (!this->full_redraw && top == this->presented[row * 2] && bottom == this->presented[row * 2 + 1]) {
+      continue;
+    }
+    cursor += std::sprintf(cursor, "\x1b[%d;1H", row + 1);
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+      int cell = (top >> 63) | ((bottom >> 63) << 1);
+      std::memcpy(cursor, glyphs[cell], glyph_lengths[cell]);
+      cursor += glyph_lengths[cell];
+      top <<= 1;
+      bottom <<= 1;
+    }
+  }
+  ssize_t written = write(STDOUT_FILENO, this->frame, cursor - this->frame);
+  (void)written;
+  std::memcpy(this->presented, screen, sizeof(this->presented));
+  this->full_redraw = false;
+}
+
+void TerminalFrontend::startInput(std::atomic<uint16_t> *keys) {
+  this->stopInput();
+  this->input_running = true;
+  this->input_thread = std::thread(&TerminalFrontend::readInput, this, keys);
+}
+
+void TerminalFrontend::stopInput(void) {
+  if (this->input_thread.joinable()) {
+    this->input_running = false;
+    this->input_thread.join();
+  }
+}
+
+void TerminalFrontend::readInput(std::atomic<uint16_t> *keys) {
+  // reads stdin directly, ncurses is not thread safe and is left to the
+  // drawing thread
+  typedef std::chrono::steady_clock clock;
+  clock::time_point last_seen[KEYS_COUNT + 1];
+  uint32_t held = 0;
+  struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+  while (this->input_running) {
+    clock::time_point now = clock::now();
+    if (poll(&input, 1, INPUT_POLL_MS) > 0) {
+      char buffer[64];
+      ssize_t length = read(STDIN_FILENO, buffer, sizeof(buffer));
+      for (ssize_t i = 0; i < length; i++) {
+        for (int key = 0; key < KEYS_COUNT; key++) {
+          if (keyboard[key] == buffer[i]) {
+            last_seen[key] = now;
+            held |= 1 << key;
+          }
+        }
+        if (buffer[i] == REWIND_KEY || buffer[i] == '\b') {
+          last_seen[KEYS_COUNT] = now;
+          held |= REWIND_BIT;
+        }
+      }
+    }
+    for (int key = 0; key <= KEYS_COUNT; key++) {
+      if ((held >> key) & 1 && now - last_seen[key] > std::chrono::milliseconds(RELEASE_MS)) {
+        held &= ~(1 << key);
+      }
+    }
+    keys->store(held & ~REWIND_BIT, std::memory_order_relaxed);
+    this->rewind_held.store((held & REWIND_BIT) != 0, std::memory_order_relaxed);
+  }
+  keys->store(0, std::memory_order_relaxed);
+  this->rewind_held = false;
+}
+
+bool TerminalFrontend::rewindHeld(void) {
+  return this->rewind_held.load(std::memory_order_relaxed);
+}
+
+void TerminalFrontend::setSound(bool on) {
+  if (on && !this->sound_on) {
+    beep();
+  }
+  this->sound_on = on;
+}
\ No newline at end of file
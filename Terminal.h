@@ -0,0 +1,43 @@
+#ifndef __TERMINAL_
+#define __TERMINAL_
+
+#include "Frontend.h"
+#include "CPU.h"
+#include <thread>
+
+// ncurses frontend, every pixel is drawn as two colored spaces and only
+// pixels that changed since the last frame are redrawn
+class TerminalFrontend : public Frontend {
+  public:
+    TerminalFrontend(void);
+    ~TerminalFrontend(void);
+    void drawScreen(const uint64_t *screen);
+    void startInput(std::atomic<uint16_t> *keys);
+    void stopInput(void);
+    bool rewindHeld(void);
+    void setSound(bool on);
+  private:
+    std::thread input_thread;
+    std::atomic<bool> input_running;
+    std::atomic<bool> rewind_held;
+    void readInput(std::atomic<uint16_t> *keys);
+    bool sound_on;
+    int current_color;
+  protected:
+    // the frame the terminal currently shows
+    uint64_t presented[SCREEN_HEIGHT];
+    bool full_redraw;
+};
+
+// draws two rows of pixels per character cell with half block glyphs.
+// Frames are encoded into one buffer and sent with a single write,
+// ncurses is only used for input
+class HalfBlockFrontend : public TerminalFrontend {
+  public:
+    void drawScreen(const uint64_t *screen);
+  private:
+    // a cursor move per cell row plus up to three bytes per cell
+    char frame[(SCREEN_HEIGHT / 2) * (16 + SCREEN_WIDTH * 3)];
+};
+
+#endif // __TERMINAL_
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int threads) {
+  if (threads <= 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  if (threads <= 0) {
+    threads = 1;
+  }
+  this->next_queue = 0;
+  this->queued = 0;
+  this->pending = 0;
+  this->stopping = false;
+  for (int i = 0; i < threads; i++) {
+    this->queues.emplace_back(new Queue());
+  }
+  for (int i = 0; i < threads; i++) {
+    this->workers.emplace_back(&ThreadPool::work, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool(void) {
+  {
+    std::lock_guard<std::mutex> guard(this->wake_lock);
+    this->stopping = true;
+  }
+  this->wake.notify_all();
+  for (std::thread &worker : this->workers) {
+    worker.join();
+  }
+}
+
+int ThreadPool::size(void) {
+  return this->workers.size();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  Queue &queue = *this->queues[this->next_queue++ % this->queues.size()];
+  this->pending++;
+  {
+    // counted first so take never sees more tasks than queued
+    std::lock_guard<std::mutex> guard(this->wake_lock);
+    this->queued++;
+  }
+  {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.tasks.push_back(std::move(task));
+  }
+  this->wake.notify_one();
+}
+
+void ThreadPool::wait(void) {
+  std::unique_lock<std::mutex> guard(this->wake_lock);
+  this->done.wait(guard, [this] { return this->pending == 0; });
+}
+
+bool ThreadPool::take(int worker, std::function<void()> &task) {
+  // newest task of our own queue first, it is the most likely to be warm
+  size_t count = this->queues.size();
+  for (size_t i = 0; i < count; i++) {
+    Queue &queue = *this->queues[(worker + i) % count];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    if (i == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    this->queued--;
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::work(int worker) {
+  std::function<void()> task;
+  while (true) {
+    if (this->take(worker, task)) {
+      task();
+      task = nullptr;
+      if (--this->pending == 0) {
+        std::lock_guard<std::mutex> guard(this->wake_lock);
+        this->done.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(this->wake_lock);
+    this->wake.wait(guard, [this] { return this->stopping || this->queued > 0; });
+    if (this->stopping) {
+      return;
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef __THREAD_POOL_
+#define __THREAD_POOL_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool. Every worker owns a queue, submitted tasks are
+// spread over the queues round robin and a worker that runs out of its
+// own tasks takes the oldest task of another worker.
+class ThreadPool {
+  public:
+    // threads defaults to the number of hardware threads
+    ThreadPool(int threads = 0);
+    // tasks still queued are dropped, call wait first to finish them
+    ~ThreadPool(void);
+    void submit(std::function<void()> task);
+    // blocks until every submitted task has finished
+    void wait(void);
+    int size(void);
+  private:
+    struct Queue {
+      std::mutex lock;
+      std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next_queue;
+    std::atomic<size_t> queued; // submitted but not yet taken
+    std::atomic<size_t> pending; // submitted but not yet finished
+    std::mutex wake_lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stopping;
+    bool take(int worker, std::function<void()> &task);
+    void work(int worker);
+};
+
+#endif // __THREAD_POOL_
\ No newline at end of file
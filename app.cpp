@@ -3,7 +3,12 @@
 #include <dirent.h>
 #include <vector>
 #include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
 #include "CPU.h"
+#include "Terminal.h"
+#include "InputLog.h"
 
 std::string getGamePath(void) {
   std::string path;
@@ -23,20 +28,80 @@ std::string getGamePath(void) {
   return path;
 }
 
+static uint32_t clock_speed = DEFAULT_CYCLES_PER_SECOND;
+static bool turbo = false;
+static bool use_jit = false;
+static int quirks = QUIRKS_MODERN;
+static bool half_block = false;
+static bool use_rewind = false;
+static const char *record_path = NULL;
+static Chip8 *running_emulator = NULL;
+
+static void stopGame(int signal) {
+  // lets runEmu return so the session can be saved
+  running_emulator->game_finished = true;
+}
+
 int runGame(std::string path) {
-  Chip8 emulator = Chip8();
+  TerminalFrontend *terminal = half_block ? new HalfBlockFrontend() : new TerminalFrontend();
+  Chip8 emulator(terminal);
+  emulator.setClockSpeed(clock_speed);
+  emulator.setTurbo(turbo);
+  emulator.setTimerMode(TIMER_WALLCLOCK);
+  emulator.setQuirks(quirks);
+  emulator.enableJit(use_jit);
+  emulator.enableRewind(use_rewind);
+  InputLog log;
+  if (record_path != NULL) {
+    emulator.recordInput(&log);
+  }
   bool loaded = emulator.loadGame(path.c_str());
   if (loaded) {
+    running_emulator = &emulator;
+    std::signal(SIGINT, stopGame);
     emulator.runEmu();
+    std::signal(SIGINT, SIG_DFL);
   } else {
     std::cout << "Couldn't load " << path << "\n";
   }
+  delete terminal;
+  if (loaded && PROFILE) {
+    // where the session spent its cycles, once the terminal is restored
+    emulator.writeProfile(stdout);
+  }
+  if (loaded && record_path != NULL && !log.save(record_path)) {
+    std::cout << "Couldn't save " << record_path << "\n";
+  }
   return 0;
 }
 
 int main(int argc, char **argv) {
-  if (argc > 1) {
-    return runGame(argv[1]);
+  const char *game = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--turbo") == 0) {
+      turbo = true;
+    } else if (std::strcmp(argv[i], "--jit") == 0) {
+      use_jit = true;
+    } else if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      quirks = findQuirks(argv[++i]);
+      if (quirks < 0) {
+        std::cout << "Unknown quirk profile " << argv[i] << "\n";
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--half-block") == 0) {
+      half_block = true;
+    } else if (std::strcmp(argv[i], "--rewind") == 0) {
+      use_rewind = true;
+    } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+      clock_speed = std::strtoul(argv[++i], NULL, 10);
+    } else {
+      game = argv[i];
+    }
+  }
+  if (game != NULL) {
+    return runGame(game);
   }
   DIR *root = opendir("./");
   if (root == NULL) {
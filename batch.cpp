@@ -0,0 +1,308 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "CPU.h"
+#include "Ensemble.h"
+#include "InputLog.h"
+#include "ThreadPool.h"
+
+#define DEFAULT_CYCLES 1000000
+#define DEFAULT_SEED 1
+#define BATCH_CYCLES 100000
+#define FNV_OFFSET 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+struct BatchRun {
+  std::string rom;
+  uint64_t cycles;
+  uint32_t seed;
+  std::string replay;
+};
+
+// seed and quirks are the ones the run actually used, a replayed input
+// log brings its own
+struct BatchResult {
+  uint32_t seed;
+  int quirks;
+  bool loaded;
+  uint64_t cycles;
+  bool finished;
+  uint64_t hash;
+  double milliseconds;
+};
+
+static void hashBytes(uint64_t &hash, const void *data, size_t size) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+}
+
+// hashed field by field, the padding inside Chip8State is undefined
+static uint64_t hashState(const Chip8State &emulator) {
+  uint64_t hash = FNV_OFFSET;
+  hashBytes(hash, emulator.memory, sizeof(emulator.memory));
+  hashBytes(hash, emulator.registers, sizeof(emulator.registers));
+  hashBytes(hash, &emulator.program_counter, sizeof(emulator.program_counter));
+  hashBytes(hash, &emulator.index_register, sizeof(emulator.index_register));
+  hashBytes(hash, &emulator.delay_timer, sizeof(emulator.delay_timer));
+  hashBytes(hash, &emulator.sound_timer, sizeof(emulator.sound_timer));
+  hashBytes(hash, emulator.stack, sizeof(emulator.stack));
+  hashBytes(hash, &emulator.stack_ptr, sizeof(emulator.stack_ptr));
+  hashBytes(hash, &emulator.timer_phase, sizeof(emulator.timer_phase));
+  hashBytes(hash, emulator.screen, sizeof(emulator.screen));
+  hashBytes(hash, &emulator.random_state, sizeof(emulator.random_state));
+  return hash;
+}
+
+static BatchResult runGame(const BatchRun &run, bool use_jit, int quirks) {
+  BatchResult result = {run.seed, quirks, false, 0, false, 0, 0};
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Chip8 emulator;
+  emulator.seedRandom(run.seed);
+  emulator.setQuirks(quirks);
+  if (!emulator.loadGame(run.rom.c_str())) {
+    return result;
+  }
+  emulator.enableJit(use_jit);
+  uint64_t cycles = 0;
+  uint64_t max_cycles = run.cycles;
+  if (!run.replay.empty()) {
+    InputLog log;
+    if (!log.load(run.replay.c_str())) {
+      return result;
+    }
+    cycles = emulator.replayInput(log, max_cycles);
+    result.seed = log.seed;
+    result.quirks = emulator.quirks;
+  }
+  while (cycles < max_cycles && !emulator.game_finished) {
+    uint64_t batch = max_cycles - cycles < BATCH_CYCLES ? max_cycles - cycles : BATCH_CYCLES;
+    cycles += emulator.runCycles(batch);
+    emulator.should_draw = false;
+  }
+  result.loaded = true;
+  result.cycles = cycles;
+  result.finished = emulator.game_finished;
+  result.hash = hashState(emulator);
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  result.milliseconds = elapsed.count();
+  return result;
+}
+
+// every lane runs the same ROM with its own seed, in lockstep on one thread
+static std::vector<BatchResult> runEnsemble(const BatchRun &run, int lanes, int quirks) {
+  std::vector<BatchResult> results(lanes, BatchResult{run.seed, quirks, false, 0, false, 0, 0});
+  for (int lane = 0; lane < lanes; lane++) {
+    results[lane].seed = run.seed + lane;
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Ensemble ensemble(lanes);
+  ensemble.setQuirks(quirks);
+  if (!ensemble.loadGame(run.rom.c_str(), run.seed)) {
+    return results;
+  }
+  uint64_t cycles = 0;
+  while (cycles < run.cycles) {
+    uint64_t batch = run.cycles - cycles < BATCH_CYCLES ? run.cycles - cycles : BATCH_CYCLES;
+    ensemble.runCycles(batch);
+    cycles += batch;
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  Chip8State state;
+  for (int lane = 0; lane < lanes; lane++) {
+    ensemble.readLane(lane, state);
+    results[lane].loaded = true;
+    results[lane].cycles = ensemble.cycles(lane);
+    results[lane].finished = ensemble.finished(lane);
+    results[lane].hash = hashState(state);
+    results[lane].milliseconds = elapsed.count();
+  }
+  return results;
+}
+
+static bool isGame(const std::string &path) {
+  size_t index = path.rfind(".");
+  if (index == std::string::npos) {
+    return false;
+  }
+  std::string extension = path.substr(index + 1);
+  return extension == "c8" || extension == "ch8";
+}
+
+static bool findGames(const std::string &directory, const BatchRun &defaults, std::vector<BatchRun> &runs) {
+  DIR *root = opendir(directory.c_str());
+  if (root == NULL) {
+    return false;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(root)) != NULL) {
+    if (isGame(entry->d_name)) {
+      BatchRun run = defaults;
+      run.rom = directory + "/" + entry->d_name;
+      runs.push_back(run);
+    }
+  }
+  closedir(root);
+  return true;
+}
+
+// one run per line: rom [cycles [seed [input log]]], # starts a comment
+static bool readManifest(const std::string &path, const BatchRun &defaults, std::vector<BatchRun> &runs) {
+  std::ifstream manifest(path);
+  if (!manifest) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(manifest, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    BatchRun run = defaults;
+    if (!(fields >> run.rom)) {
+      continue;
+    }
+    std::string value;
+    if (fields >> value) {
+      run.cycles = std::strtoull(value.c_str(), NULL, 10);
+    }
+    if (fields >> value) {
+      run.seed = std::strtoul(value.c_str(), NULL, 10);
+    }
+    if (fields >> value) {
+      run.replay = value;
+    }
+    runs.push_back(run);
+  }
+  return true;
+}
+
+static std::string escapeJson(const std::string &text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+static void writeResults(std::ostream &out, const std::vector<BatchRun> &runs, const std::vector<BatchResult> &results, bool json) {
+  char hash[17];
+  if (json) {
+    out << "[\n";
+  } else {
+    out << "rom,seed,quirks,loaded,cycles,finished,hash,milliseconds\n";
+  }
+  for (size_t i = 0; i < runs.size(); i++) {
+    const BatchResult &result = results[i];
+    std::snprintf(hash, sizeof(hash), "%.16llx", (unsigned long long)result.hash);
+    const char *quirks = quirk_profiles[result.quirks].name;
+    if (json) {
+      out << "  {\"rom\": \"" << escapeJson(runs[i].rom) << "\", \"seed\": " << result.seed << ", \"quirks\": \"" << quirks <<
+             "\", \"loaded\": " << (result.loaded ? "true" : "false") <<
+             ", \"cycles\": " << result.cycles << ", \"finished\": " << (result.finished ? "true" : "false") <<
+             ", \"hash\": \"" << hash << "\", \"milliseconds\": " << result.milliseconds << "}" <<
+             (i + 1 < runs.size() ? ",\n" : "\n");
+    } else {
+      out << runs[i].rom << "," << result.seed << "," << quirks << "," << result.loaded << "," << result.cycles << "," << result.finished << "," <<
+             hash << "," << result.milliseconds << "\n";
+    }
+  }
+  if (json) {
+    out << "]\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cout << "Usage: " << argv[0] << " (directory | manifest | rom) [--cycles n] [--seed n] [--replay file] [--jit] [--quirks profile] [--threads n] [--json] [--output file]\n" <<
+                 "       " << argv[0] << " rom --ensemble n [--cycles n] [--seed n] [--quirks profile] [--json] [--output file]\n";
+    return 1;
+  }
+  BatchRun defaults = {"", DEFAULT_CYCLES, DEFAULT_SEED, ""};
+  bool use_jit = false;
+  int quirks = QUIRKS_MODERN;
+  bool json = false;
+  int threads = 0;
+  int lanes = 0;
+  const char *output = NULL;
+  for (int i = 2; i < argc; i++) {
+    if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      defaults.cycles = std::strtoull(argv[++i], NULL, 10);
+    } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      defaults.seed = std::strtoul(argv[++i], NULL, 10);
+    } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      defaults.replay = argv[++i];
+    } else if (std::strcmp(argv[i], "--jit") == 0) {
+      use_jit = true;
+    } else if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      quirks = findQuirks(argv[++i]);
+      if (quirks < 0) {
+        std::cout << "Unknown quirk profile " << argv[i] << "\n";
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--ensemble") == 0 && i + 1 < argc) {
+      lanes = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    }
+  }
+  std::vector<BatchRun> runs;
+  std::vector<BatchResult> results;
+  if (lanes > 0) {
+    defaults.rom = argv[1];
+    results = runEnsemble(defaults, lanes, quirks);
+    for (int lane = 0; lane < lanes; lane++) {
+      runs.push_back(defaults);
+      runs.back().seed = defaults.seed + lane;
+    }
+  } else {
+    struct stat info;
+    bool found = true;
+    if (stat(argv[1], &info) == 0 && S_ISDIR(info.st_mode)) {
+      found = findGames(argv[1], defaults, runs);
+    } else if (isGame(argv[1])) {
+      // a lone ROM is a batch of one rather than a manifest
+      runs.push_back(defaults);
+      runs.back().rom = argv[1];
+    } else {
+      found = readManifest(argv[1], defaults, runs);
+    }
+    if (!found) {
+      std::cout << "Couldn't read " << argv[1] << "\n";
+      return 1;
+    }
+    results.resize(runs.size());
+    ThreadPool pool(threads);
+    for (size_t i = 0; i < runs.size(); i++) {
+      pool.submit([&runs, &results, i, use_jit, quirks] {
+        results[i] = runGame(runs[i], use_jit, quirks);
+      });
+    }
+    pool.wait();
+  }
+  if (output == NULL) {
+    writeResults(std::cout, runs, results, json);
+    return 0;
+  }
+  std::ofstream out(output);
+  if (!out) {
+    std::cout << "Couldn't open " << output << "\n";
+    return 1;
+  }
+  writeResults(out, runs, results, json);
+  return 0;
+}
\ No newline at end of file
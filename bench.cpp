@@ -0,0 +1,262 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "CPU.h"
+#include "Disassembler.h"
+
+// nearest rank p99 is only distinct from the maximum from 100 samples
+// up, shorter runs keep the default as quick as 21 runs of a million
+#define DEFAULT_RUNS 100
+#define DEFAULT_CYCLES 250000
+#define BATCH_CYCLES 100000
+#define BENCH_SEED 1
+#define DASM_PASSES 64
+
+#define ENGINE_INTERPRETER 0
+#define ENGINE_REFERENCE 1
+#define ENGINE_JIT 2
+
+struct Workload {
+  const char *name;
+  std::vector<uint16_t> code;
+};
+
+struct BenchResult {
+  std::string name;
+  std::string engine;
+  std::string unit;
+  std::vector<double> nanoseconds; // per unit, one entry per run
+};
+
+static const char *engine_names[] = {"interpreter", "reference", "jit"};
+
+// Each workload loops forever over one opcode family, so every measured
+// cycle exercises that family and the jump back to the start.
+static std::vector<Workload> syntheticWorkloads(void) {
+  std::vector<Workload> workloads;
+  // 8XYN arithmetic on four registers
+  workloads.push_back({"alu", {
+    0x6001, 0x6103, 0x6207, 0x630F,
+    0x8014, 0x8125, 0x8236, 0x8347, 0x845E, 0x8561, 0x8672, 0x8783,
+    0x8014, 0x8125, 0x7001, 0x7102, 0x1208
+  }});
+  // DXYN sprites walking across the screen, cleared once per loop
+  workloads.push_back({"draw", {
+    0xA220, 0x6000, 0x6100,
+    0xD01F, 0x7009, 0x7103, 0xD018, 0x7005, 0x00E0, 0x1206,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0xF0F0, 0x9090, 0xF0F0, 0x9090, 0xF0F0, 0x9090, 0xF0F0, 0x9000
+  }});
+  // FX55/FX65 block moves and FX33 through I
+  workloads.push_back({"memory", {
+    0xA300, 0xFF55, 0xFF65, 0xA340, 0xF733, 0xFF65, 0xA380, 0xFF55, 0xFF65, 0x7001, 0x1200
+  }});
+  // calls, returns, taken skips and plain jumps
+  workloads.push_back({"jumps", {
+    0x2212, 0x3000, 0x1200, 0x4001, 0x1200, 0x5000, 0x1200, 0x2216, 0x1200,
+    0x1214, 0x00EE, 0x9010, 0x00EE
+  }});
+  return workloads;
+}
+
+// a ROM of every opcode kind the disassembler knows, with no 0x0000 until
+// the end of memory
+static std::vector<uint8_t> disassemblerRom(void) {
+  static const uint16_t kinds[] = {
+    0x00E0, 0x00EE, 0x1234, 0x2345, 0x3A12, 0x4B34, 0x5AB0, 0x6C56, 0x7D78,
+    0x8AB0, 0x8AB1, 0x8AB2, 0x8AB3, 0x8AB4, 0x8AB5, 0x8AB6, 0x8AB7, 0x8ABE,
+    0x9AB0, 0xA456, 0xB567, 0xCA9A, 0xDAB5, 0xEA9E, 0xEAA1,
+    0xFA07, 0xFA0A, 0xFA15, 0xFA18, 0xFA1E, 0xFA29, 0xFA33, 0xFA55, 0xFA65
+  };
+  std::vector<uint8_t> rom;
+  for (int i = 0; rom.size() + 2 <= MEM_SIZE - INTERPRETER_SIZE; i++) {
+    uint16_t opcode = kinds[i % (sizeof(kinds) / sizeof(kinds[0]))];
+    rom.push_back(opcode >> 8);
+    rom.push_back(opcode & 0xFF);
+  }
+  return rom;
+}
+
+static bool readRom(const char *name, std::vector<uint8_t> &rom) {
+  std::ifstream file(name, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return rom.size() <= MEM_SIZE - INTERPRETER_SIZE;
+}
+
+static void runFor(Chip8 *emulator, uint64_t max_cycles) {
+  uint64_t cycles = 0;
+  while (cycles < max_cycles && !emulator->game_finished) {
+    uint64_t batch = max_cycles - cycles < BATCH_CYCLES ? max_cycles - cycles : BATCH_CYCLES;
+    cycles += emulator->runCycles(batch);
+    emulator->should_draw = false;
+  }
+}
+
+// every run starts from a freshly loaded machine, so the JIT's compile
+// time is part of the measurement just as it is for a real session
+static Chip8 *bootEmulator(const std::vector<uint8_t> &rom, int engine) {
+  Chip8 *emulator = new Chip8();
+  emulator->seedRandom(BENCH_SEED);
+  std::memcpy(emulator->memory + INTERPRETER_SIZE, rom.data(), rom.size());
+  emulator->invalidateDecoded(INTERPRETER_SIZE, rom.size());
+  emulator->reference_dispatch = engine == ENGINE_REFERENCE;
+  emulator->enableJit(engine == ENGINE_JIT);
+  return emulator;
+}
+
+static BenchResult benchEmulator(const std::string &name, const std::vector<uint8_t> &rom, int engine, int runs, uint64_t cycles) {
+  BenchResult result = {name, engine_names[engine], "cycle", {}};
+  // one unmeasured run to warm caches and the page tables
+  for (int run = -1; run < runs; run++) {
+    Chip8 *emulator = bootEmulator(rom, engine);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    runFor(emulator, cycles);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t executed = emulator->cycle_count;
+    delete emulator;
+    if (run >= 0 && executed > 0) {
+      result.nanoseconds.push_back(elapsed.count() / executed);
+    }
+  }
+  return result;
+}
+
+static BenchResult benchDisassembler(const std::string &name, const std::vector<uint8_t> &rom, int runs) {
+  BenchResult result = {name, "disassembler", "byte", {}};
+  std::FILE *sink = std::fopen("/dev/null", "w");
+  if (sink == NULL) {
+    return result;
+  }
+  Disassembler disassembler(rom.data(), rom.size());
+  for (int run = -1; run < runs; run++) {
+    uint64_t bytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < DASM_PASSES; pass++) {
+      bytes += disassembler.disassemble(sink);
+    }
+    std::fflush(sink);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (run >= 0 && bytes > 0) {
+      result.nanoseconds.push_back(elapsed.count() / bytes);
+    }
+  }
+  std::fclose(sink);
+  return result;
+}
+
+// nearest rank on the sorted samples, with fewer than 100 of them p99 is
+// the maximum
+static double percentile(const std::vector<double> &sorted, int percent) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank = (sorted.size() * percent + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static std::string escapeJson(const std::string &text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+static void writeResults(std::ostream &out, std::vector<BenchResult> &results, bool json) {
+  char numbers[128];
+  if (json) {
+    out << "[\n";
+  } else {
+    out << "benchmark,engine,unit,runs,median_ns,p99_ns,median_per_second\n";
+  }
+  for (size_t i = 0; i < results.size(); i++) {
+    BenchResult &result = results[i];
+    std::sort(result.nanoseconds.begin(), result.nanoseconds.end());
+    double median = percentile(result.nanoseconds, 50);
+    double p99 = percentile(result.nanoseconds, 99);
+    double rate = median > 0 ? 1e9 / median : 0;
+    if (json) {
+      std::snprintf(numbers, sizeof(numbers), "\"runs\": %zu, \"median_ns\": %.4f, \"p99_ns\": %.4f, \"median_per_second\": %.0f",
+                    result.nanoseconds.size(), median, p99, rate);
+      out << "  {\"benchmark\": \"" << escapeJson(result.name) << "\", \"engine\": \"" << result.engine <<
+             "\", \"unit\": \"" << result.unit << "\", " << numbers << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    } else {
+      std::snprintf(numbers, sizeof(numbers), "%zu,%.4f,%.4f,%.0f", result.nanoseconds.size(), median, p99, rate);
+      out << result.name << "," << result.engine << "," << result.unit << "," << numbers << "\n";
+    }
+  }
+  if (json) {
+    out << "]\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  int runs = DEFAULT_RUNS;
+  uint64_t cycles = DEFAULT_CYCLES;
+  bool json = false;
+  const char *output = NULL;
+  std::vector<const char *> roms;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      runs = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      cycles = std::strtoull(argv[++i], NULL, 10);
+    } else if (std::strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (argv[i][0] == '-') {
+      std::cout << "Usage: " << argv[0] << " [rom...] [--runs n] [--cycles n] [--json] [--output file]\n";
+      return 1;
+    } else {
+      roms.push_back(argv[i]);
+    }
+  }
+  std::vector<BenchResult> results;
+  std::vector<Workload> workloads = syntheticWorkloads();
+  for (const Workload &workload : workloads) {
+    std::vector<uint8_t> rom;
+    for (uint16_t opcode : workload.code) {
+      rom.push_back(opcode >> 8);
+      rom.push_back(opcode & 0xFF);
+    }
+    for (int engine = ENGINE_INTERPRETER; engine <= ENGINE_JIT; engine++) {
+      results.push_back(benchEmulator(workload.name, rom, engine, runs, cycles));
+    }
+  }
+  results.push_back(benchDisassembler("opcodes", disassemblerRom(), runs));
+  for (const char *name : roms) {
+    std::vector<uint8_t> rom;
+    if (!readRom(name, rom)) {
+      std::cout << "Couldn't load " << name << "\n";
+      return 1;
+    }
+    for (int engine = ENGINE_INTERPRETER; engine <= ENGINE_JIT; engine++) {
+      results.push_back(benchEmulator(name, rom, engine, runs, cycles));
+    }
+    results.push_back(benchDisassembler(name, rom, runs));
+  }
+  if (output == NULL) {
+    writeResults(std::cout, results, json);
+    return 0;
+  }
+  std::ofstream out(output);
+  if (!out) {
+    std::cout << "Couldn't open " << output << "\n";
+    return 1;
+  }
+  writeResults(out, results, json);
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "Disassembler.h"
+#include "ThreadPool.h"
+
+struct DasmResult {
+  bool loaded;
+  bool listed;
+  int size;
+  uint64_t kinds[KIND_COUNT];
+  double milliseconds;
+};
+
+static bool isGame(const std::string &path) {
+  size_t index = path.rfind(".");
+  if (index == std::string::npos) {
+    return false;
+  }
+  std::string extension = path.substr(index + 1);
+  return extension == "c8" || extension == "ch8";
+}
+
+static bool findGames(const std::string &directory, std::vector<std::string> &roms) {
+  DIR *root = opendir(directory.c_str());
+  if (root == NULL) {
+    return false;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(root)) != NULL) {
+    if (isGame(entry->d_name)) {
+      roms.push_back(directory + "/" + entry->d_name);
+    }
+  }
+  closedir(root);
+  return true;
+}
+
+// one ROM per line, # starts a comment
+static bool readList(const std::string &path, std::vector<std::string> &roms) {
+  std::ifstream list(path);
+  if (!list) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(list, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string rom;
+    if (fields >> rom) {
+      roms.push_back(rom);
+    }
+  }
+  return true;
+}
+
+static DasmResult disassembleGame(const std::string &rom, bool listing, bool flow) {
+  DasmResult result = {false, false, 0, {}, 0};
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Disassembler disassembler;
+  if (disassembler.load(rom)) {
+    result.loaded = true;
+    result.size = disassembler.size();
+    disassembler.flow = flow;
+    result.listed = listing && disassembler.disassemble() >= 0;
+    disassembler.count(result.kinds);
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  result.milliseconds = elapsed.count();
+  return result;
+}
+
+static std::string escapeJson(const std::string &text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+static void writeKinds(std::ostream &out, const uint64_t kinds[KIND_COUNT], bool json) {
+  for (int kind = 0; kind < KIND_COUNT; kind++) {
+    if (json) {
+      out << (kind > 0 ? ", \"" : "{\"") << opcode_kind_names[kind] << "\": " << kinds[kind];
+    } else {
+      out << "," << kinds[kind];
+    }
+  }
+  if (json) {
+    out << "}";
+  }
+}
+
+// one row per ROM and a total row, whose loaded and listed columns count
+// the ROMs and whose milliseconds add up the time of every ROM
+static void writeReport(std::ostream &out, const std::vector<std::string> &roms, const std::vector<DasmResult> &results, bool json) {
+  DasmResult total = {false, false, 0, {}, 0};
+  int loaded = 0;
+  int listed = 0;
+  if (json) {
+    out << "{\"files\": [\n";
+  } else {
+    out << "rom,loaded,listed,bytes,milliseconds";
+    for (int kind = 0; kind < KIND_COUNT; kind++) {
+      out << "," << opcode_kind_names[kind];
+    }
+    out << "\n";
+  }
+  for (size_t i = 0; i < roms.size(); i++) {
+    const DasmResult &result = results[i];
+    loaded += result.loaded;
+    listed += result.listed;
+    total.size += result.size;
+    total.milliseconds += result.milliseconds;
+    for (int kind = 0; kind < KIND_COUNT; kind++) {
+      total.kinds[kind] += result.kinds[kind];
+    }
+    if (json) {
+      out << "  {\"rom\": \"" << escapeJson(roms[i]) << "\", \"loaded\": " << (result.loaded ? "true" : "false") <<
+             ", \"listed\": " << (result.listed ? "true" : "false") << ", \"bytes\": " << result.size <<
+             ", \"milliseconds\": " << result.milliseconds << ", \"kinds\": ";
+      writeKinds(out, result.kinds, json);
+      out << "}" << (i + 1 < roms.size() ? ",\n" : "\n");
+    } else {
+      out << roms[i] << "," << result.loaded << "," << result.listed << "," << result.size << "," << result.milliseconds;
+      writeKinds(out, result.kinds, json);
+      out << "\n";
+    }
+  }
+  if (json) {
+    out << "], \"total\": {\"files\": " << roms.size() << ", \"loaded\": " << loaded << ", \"listed\": " << listed <<
+           ", \"bytes\": " << total.size << ", \"milliseconds\": " << total.milliseconds << ", \"kinds\": ";
+    writeKinds(out, total.kinds, json);
+    out << "}}\n";
+  } else {
+    out << "total," << loaded << "," << listed << "," << total.size << "," << total.milliseconds;
+    writeKinds(out, total.kinds, json);
+    out << "\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  bool trace = false;
+  bool flow = false;
+  bool listing = true;
+  bool json = false;
+  bool report = false;
+  int threads = 0;
+  const char *output = NULL;
+  std::vector<std::string> roms;
+  for (int i = 1; i < argc; i++) {
+    struct stat info;
+    if (std::strcmp(argv[i], "--trace") == 0) {
+      trace = true;
+    } else if (std::strcmp(argv[i], "--flow") == 0) {
+      flow = true;
+    } else if (std::strcmp(argv[i], "--no-listing") == 0) {
+      listing = false;
+      report = true;
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = std::atoi(argv[++i]);
+      report = true;
+    } else if (std::strcmp(argv[i], "--json") == 0) {
+      json = true;
+      report = true;
+    } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output = argv[++i];
+      report = true;
+    } else if (stat(argv[i], &info) == 0 && S_ISDIR(info.st_mode)) {
+      if (!findGames(argv[i], roms)) {
+        std::cout << "Couldn't read " << argv[i] << "\n";
+        return 1;
+      }
+      report = true;
+    } else if (isGame(argv[i])) {
+      roms.push_back(argv[i]);
+    } else {
+      if (!readList(argv[i], roms)) {
+        std::cout << "Couldn't read " << argv[i] << "\n";
+        return 1;
+      }
+      report = true;
+    }
+  }
+  if (roms.empty() && !report) {
+    std::cout << "Usage: " << argv[0] << " [--trace] [--flow] game.ch8\n" <<
+                 "       " << argv[0] << " (game | directory | list)... [--flow] [--no-listing] [--threads n] [--json] [--output file]\n";
+    std::exit(0);
+  }
+  if (roms.size() == 1 && !report) {
+    Disassembler disassembler(roms[0]);
+    disassembler.trace = trace;
+    disassembler.flow = flow;
+    if (disassembler.disassemble() < 0) {
+      std::cout << "Couldn't create output file!\n";
+      std::exit(0);
+    }
+    if (trace) {
+      std::cout << "Done!\n";
+    }
+    return 0;
+  }
+  std::vector<DasmResult> results(roms.size());
+  ThreadPool pool(threads);
+  for (size_t i = 0; i < roms.size(); i++) {
+    pool.submit([&roms, &results, i, listing, flow] {
+      results[i] = disassembleGame(roms[i], listing, flow);
+    });
+  }
+  pool.wait();
+  if (output == NULL) {
+    writeReport(std::cout, roms, results, json);
+    return 0;
+  }
+  std::ofstream out(output);
+  if (!out) {
+    std::cout << "Couldn't open " << output << "\n";
+    return 1;
+  }
+  writeReport(out, roms, results, json);
+  return 0;
+}
\ No newline at end of file
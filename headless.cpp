@@ -0,0 +1,101 @@
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "CPU.h"
+#include "InputLog.h"
+
+#define DEFAULT_CYCLES 1000000
+#define BATCH_CYCLES 100000
+
+static void printState(Chip8 &emulator, uint64_t cycles) {
+  std::printf("cycles: %llu\n", (unsigned long long)cycles);
+  std::printf("finished: %s\n", emulator.game_finished ? "yes" : "no");
+  std::printf("pc: 0x%.4X\n", emulator.program_counter);
+  std::printf("index: 0x%.4X\n", emulator.index_register);
+  std::printf("delay: %hhu\n", emulator.delay_timer);
+  std::printf("sound: %hhu\n", emulator.sound_timer);
+  std::printf("sp: %hhu\n", emulator.stack_ptr);
+  for (int i = 0; i < REGISTER_COUNT; i++) {
+    std::printf("V%X: 0x%.2X%s", i, emulator.registers[i], i % 8 == 7 ? "\n" : " ");
+  }
+  for (int y = 0; y < SCREEN_HEIGHT; y++) {
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+      std::putchar(SCREEN_PIXEL(emulator.screen, x, y) ? '#' : '.');
+    }
+    std::putchar('\n');
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cout << "Usage: " << argv[0] << " game [cycles] [--jit] [--quirks profile] [--load-state file] [--save-state file] [--replay file]\n";
+    return 1;
+  }
+  uint64_t max_cycles = DEFAULT_CYCLES;
+  bool use_jit = false;
+  int quirks = QUIRKS_MODERN;
+  const char *load_state = NULL;
+  const char *save_state = NULL;
+  const char *replay = NULL;
+  bool cycles_given = false;
+  for (int i = 2; i < argc; i++) {
+    if (std::strcmp(argv[i], "--jit") == 0) {
+      use_jit = true;
+    } else if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      quirks = findQuirks(argv[++i]);
+      if (quirks < 0) {
+        std::cout << "Unknown quirk profile " << argv[i] << "\n";
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--load-state") == 0 && i + 1 < argc) {
+      load_state = argv[++i];
+    } else if (std::strcmp(argv[i], "--save-state") == 0 && i + 1 < argc) {
+      save_state = argv[++i];
+    } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay = argv[++i];
+    } else {
+      max_cycles = std::strtoull(argv[i], NULL, 10);
+      cycles_given = true;
+    }
+  }
+  Chip8 emulator;
+  emulator.setQuirks(quirks);
+  if (!emulator.loadGame(argv[1])) {
+    std::cout << "Couldn't load " << argv[1] << "\n";
+    return 1;
+  }
+  if (load_state != NULL && !emulator.loadStateFile(load_state)) {
+    std::cout << "Couldn't load state " << load_state << "\n";
+    return 1;
+  }
+  emulator.enableJit(use_jit);
+  uint64_t cycles = 0;
+  if (replay != NULL) {
+    InputLog log;
+    if (!log.load(replay)) {
+      std::cout << "Couldn't load input log " << replay << "\n";
+      return 1;
+    }
+    // the whole recorded session unless told otherwise
+    cycles = emulator.replayInput(log, cycles_given ? max_cycles : log.end_cycle);
+    max_cycles = cycles;
+  }
+  while (cycles < max_cycles && !emulator.game_finished) {
+    uint64_t batch = max_cycles - cycles < BATCH_CYCLES ? max_cycles - cycles : BATCH_CYCLES;
+    cycles += emulator.runCycles(batch);
+    // nobody presents frames, just acknowledge them
+    emulator.should_draw = false;
+  }
+  printState(emulator, cycles);
+  if (PROFILE) {
+    std::printf("\n");
+    emulator.writeProfile(stdout);
+  }
+  if (save_state != NULL && !emulator.saveStateFile(save_state)) {
+    std::cout << "Couldn't save state " << save_state << "\n";
+    return 1;
+  }
+  return 0;
+}
\ No newline at end of file
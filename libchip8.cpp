@@ -0,0 +1,85 @@
+#include "libchip8.h"
+#include "CPU.h"
+#include <new>
+
+struct chip8 {
+  Chip8 core;
+};
+
+chip8 *chip8_create(void) {
+  return new (std::nothrow) chip8();
+}
+
+void chip8_destroy(chip8 *chip) {
+  delete chip;
+}
+
+int chip8_load_rom(chip8 *chip, const uint8_t *rom, size_t size) {
+  if (size > MAX_ROM_SIZE) {
+    return 0;
+  }
+  chip->core.reset();
+  return chip->core.loadGame(rom, size);
+}
+
+chip8_step_result chip8_step(chip8 *chip, uint32_t cycles) {
+  Chip8 &core = chip->core;
+  chip8_step_result result = {0, 0};
+  if (!core.game_finished) {
+    result.cycles = core.runCycles(cycles);
+  }
+  // reporting the frame acknowledges it
+  if (core.should_draw) {
+    result.events |= CHIP8_EVENT_FRAME;
+    core.should_draw = false;
+  }
+  if (core.sound_timer > 0) {
+    result.events |= CHIP8_EVENT_SOUND;
+  }
+  uint16_t address = core.program_counter & 0xFFF;
+  uint16_t opcode = (core.memory[address] << 8) | core.memory[(address + 1) & 0xFFF];
+  if ((opcode & 0xF0FF) == 0xF00A && core.getKey() == -1) {
+    result.events |= CHIP8_EVENT_KEY_WAIT;
+  }
+  if (core.game_finished) {
+    result.events |= CHIP8_EVENT_FINISHED;
+  }
+  return result;
+}
+
+void chip8_set_keys(chip8 *chip, uint16_t keys) {
+  chip->core.keys = keys;
+}
+
+void chip8_seed(chip8 *chip, uint32_t seed) {
+  chip->core.seedRandom(seed);
+}
+
+void chip8_set_clock(chip8 *chip, uint32_t cycles_per_second) {
+  chip->core.setClockSpeed(cycles_per_second);
+}
+
+int chip8_set_quirks(chip8 *chip, const char *name) {
+  int profile = findQuirks(name);
+  if (profile < 0) {
+    return 0;
+  }
+  chip->core.setQuirks(profile);
+  return 1;
+}
+
+void chip8_enable_jit(chip8 *chip, int enabled) {
+  chip->core.enableJit(enabled != 0);
+}
+
+uint64_t chip8_cycles(const chip8 *chip) {
+  return chip->core.cycle_count;
+}
+
+const uint64_t *chip8_screen(const chip8 *chip) {
+  return chip->core.screen;
+}
+
+const Chip8State *chip8_state(const chip8 *chip) {
+  return &chip->core;
+}
\ No newline at end of file
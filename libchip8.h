@@ -0,0 +1,58 @@
+#ifndef __LIBCHIP8_
+#define __LIBCHIP8_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Chip8State.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8_API __attribute__((visibility("default")))
+
+// what happened during a chip8_step
+#define CHIP8_EVENT_FRAME 0x01 // the screen changed and should be presented
+#define CHIP8_EVENT_SOUND 0x02 // the sound timer is running
+#define CHIP8_EVENT_KEY_WAIT 0x04 // FX0A is waiting for a key
+#define CHIP8_EVENT_FINISHED 0x08 // the game ended
+
+typedef struct chip8 chip8;
+
+typedef struct chip8_step_result {
+  uint32_t cycles; // cycles actually run
+  uint32_t events; // CHIP8_EVENT_* flags
+} chip8_step_result;
+
+// An emulator without a frontend, the caller presents frames, plays sound
+// and feeds keys. Timers follow emulated time, 60 ticks for every
+// second's worth of cycles at the clock speed (500 Hz by default).
+CHIP8_API chip8 *chip8_create(void);
+CHIP8_API void chip8_destroy(chip8 *chip);
+// resets the machine to power on (memory, registers, stack, timers,
+// screen, keys and cycle count) and copies the ROM to 0x200, returns 0 if
+// it's too big. The clock, quirks, JIT and random generator are kept, so
+// seed again after loading to replay a run exactly.
+CHIP8_API int chip8_load_rom(chip8 *chip, const uint8_t *rom, size_t size);
+// runs up to cycles cycles, stopping early once a frame is ready or the
+// game has finished
+CHIP8_API chip8_step_result chip8_step(chip8 *chip, uint32_t cycles);
+// bit i is set while key i is held
+CHIP8_API void chip8_set_keys(chip8 *chip, uint16_t keys);
+// the generator behind CXNN, seeded from the clock by chip8_create
+CHIP8_API void chip8_seed(chip8 *chip, uint32_t seed);
+CHIP8_API void chip8_set_clock(chip8 *chip, uint32_t cycles_per_second);
+// modern, vip, chip48 or schip, returns 0 for an unknown name
+CHIP8_API int chip8_set_quirks(chip8 *chip, const char *name);
+CHIP8_API void chip8_enable_jit(chip8 *chip, int enabled);
+CHIP8_API uint64_t chip8_cycles(const chip8 *chip);
+// Borrowed pointers into the machine itself, valid until chip8_destroy.
+// They change during chip8_step and are meant to be read between steps.
+CHIP8_API const uint64_t *chip8_screen(const chip8 *chip); // CHIP8_SCREEN_HEIGHT rows
+CHIP8_API const Chip8State *chip8_state(const chip8 *chip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LIBCHIP8_
\ No newline at end of file
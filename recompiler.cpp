@@ -0,0 +1,420 @@
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <cstring>
+#include <vector>
+#include "Quirks.h"
+
+#define MEM_SIZE 4096
+#define OPCODE_SIZE 2
+#define PROGRAM_START 0x200
+#define MAX_BLOCK_LENGTH 64
+
+// how a block ends after an instruction
+#define FLOW_NEXT 0 // falls through
+#define FLOW_JUMP 1 // static jump to NNN
+#define FLOW_SKIP 2 // conditional skip of the next instruction
+#define FLOW_CALL 3 // subroutine call, returns to the next instruction
+#define FLOW_STOP 4 // handed to the interpreter, continues at the next instruction
+#define FLOW_INDIRECT 5 // target only known at run time
+
+// Translates a ROM into a C++ translation unit. Code reachable from
+// 0x200 is split into basic blocks, each block becomes a label in one
+// function and blocks with static successors jump straight to them.
+class Recompiler {
+  private:
+    uint8_t memory[MEM_SIZE];
+    int rom_size;
+    int quirks; // the profile the generated code hardwires
+    std::string filename;
+    bool block_start[MEM_SIZE];
+    bool timer_block[MEM_SIZE];
+    uint8_t coverage[MEM_SIZE];
+    std::vector<uint16_t> blocks;
+    uint16_t opcodeAt(uint16_t address) {
+      return (memory[address] << 8) | memory[address + 1];
+    }
+    bool inRom(uint16_t address) {
+      return address >= PROGRAM_START && address + 1 < PROGRAM_START + rom_size;
+    }
+    static int flowOf(uint16_t opcode) {
+      switch (opcode >> 12) {
+        case 0x0:
+          if (opcode == 0x0000 || opcode == 0x00EE) {
+            return FLOW_INDIRECT;
+          }
+          return FLOW_NEXT;
+        case 0x1:
+          return FLOW_JUMP;
+        case 0x2:
+          return FLOW_CALL;
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x9:
+          return FLOW_SKIP;
+        case 0xB:
+          return FLOW_INDIRECT;
+        case 0xE:
+          if ((opcode & 0x00FF) == 0x009E || (opcode & 0x00FF) == 0x00A1) {
+            return FLOW_SKIP;
+          }
+          return FLOW_NEXT;
+        case 0xF:
+          switch (opcode & 0x00FF) {
+            case 0x0A:
+            case 0x33:
+            case 0x55:
+              // key waits may not advance and stores may rewrite code
+              return FLOW_STOP;
+          }
+      }
+      return FLOW_NEXT;
+    }
+    static bool touchesTimers(uint16_t opcode) {
+      uint8_t low = opcode & 0x00FF;
+      return (opcode >> 12) == 0xF && (low == 0x07 || low == 0x15 || low == 0x18);
+    }
+    // FX07, 3XNN, 1NNN polling the delay timer, mirrors Chip8::isDelayLoop
+    bool isDelayLoop(uint16_t jump_address) {
+      if (jump_address < PROGRAM_START + 4) {
+        return false;
+      }
+      uint16_t start = jump_address - 4;
+      uint16_t read = this->opcodeAt(start);
+      uint16_t test = this->opcodeAt(start + 2);
+      return this->opcodeAt(jump_address) == (0x1000 | start) && (read & 0xF0FF) == 0xF007 &&
+             (test & 0xFF00) == (0x3000 | (read & 0x0F00));
+    }
+    // returns the number of instructions in the block starting at start
+    int scanBlock(uint16_t start, std::vector<uint16_t> &successors) {
+      int length = 0;
+      uint16_t address = start;
+      while (length < MAX_BLOCK_LENGTH && this->inRom(address)) {
+        uint16_t opcode = this->opcodeAt(address);
+        length++;
+        switch (flowOf(opcode)) {
+          case FLOW_NEXT:
+            address += OPCODE_SIZE;
+            continue;
+          case FLOW_JUMP:
+            successors.push_back(opcode & 0x0FFF);
+            break;
+          case FLOW_SKIP:
+            successors.push_back(address + OPCODE_SIZE);
+            successors.push_back(address + 2 * OPCODE_SIZE);
+            break;
+          case FLOW_CALL:
+            successors.push_back(opcode & 0x0FFF);
+            successors.push_back(address + OPCODE_SIZE);
+            break;
+          case FLOW_STOP:
+            successors.push_back(address + OPCODE_SIZE);
+            break;
+        }
+        return length;
+      }
+      if (length > 0) {
+        successors.push_back(address);
+      }
+      return length;
+    }
+    void findBlocks(void) {
+      std::vector<uint16_t> pending;
+      pending.push_back(PROGRAM_START);
+      while (!pending.empty()) {
+        uint16_t start = pending.back();
+        pending.pop_back();
+        if (!this->inRom(start) || this->block_start[start]) {
+          continue;
+        }
+        std::vector<uint16_t> successors;
+        int length = this->scanBlock(start, successors);
+        this->block_start[start] = true;
+        this->blocks.push_back(start);
+        for (int i = 0; i < length; i++) {
+          uint16_t address = start + i * OPCODE_SIZE;
+          this->coverage[address] = 1;
+          this->coverage[address + 1] = 1;
+          if (touchesTimers(this->opcodeAt(address))) {
+            this->timer_block[start] = true;
+          }
+        }
+        pending.insert(pending.end(), successors.begin(), successors.end());
+      }
+    }
+    void writeExit(std::FILE *out, uint16_t target, const char *indent) {
+      std::fprintf(out, "%schip->program_counter = 0x%.3X;\n", indent, target);
+      if (target < MEM_SIZE && this->block_start[target] && !this->timer_block[target]) {
+        std::fprintf(out, "%sif (chip->should_draw) return cycles;\n", indent);
+        std::fprintf(out, "%sgoto block_%.3X;\n", indent, target);
+      } else {
+        std::fprintf(out, "%sreturn cycles;\n", indent);
+      }
+    }
+    void writeInterpreted(std::FILE *out, uint16_t address, uint16_t opcode) {
+      std::fprintf(out, "  chip->program_counter = 0x%.3X;\n", address);
+      std::fprintf(out, "  chip->current_opcode = 0x%.4X;\n", opcode);
+      std::fprintf(out, "  chip->executeOpcode();\n");
+    }
+    // emits the statement for an opcode that falls through, returns
+    // false if it has to run in the interpreter
+    bool writeStatement(std::FILE *out, uint16_t opcode) {
+      uint8_t x = (opcode & 0x0F00) >> 8;
+      uint8_t y = (opcode & 0x00F0) >> 4;
+      uint8_t nn = opcode & 0x00FF;
+      uint16_t nnn = opcode & 0x0FFF;
+      switch (opcode >> 12) {
+        case 0x6:
+          std::fprintf(out, "  V[%hhu] = %hhu;\n", x, nn);
+          return true;
+        case 0x7:
+          std::fprintf(out, "  V[%hhu] += %hhu;\n", x, nn);
+          return true;
+        case 0x8:
+          switch (opcode & 0x000F) {
+            case 0x0:
+              std::fprintf(out, "  V[%hhu] = V[%hhu];\n", x, y);
+              return true;
+            case 0x1:
+              std::fprintf(out, "  V[%hhu] |= V[%hhu];\n", x, y);
+              return true;
+            case 0x2:
+              std::fprintf(out, "  V[%hhu] &= V[%hhu];\n", x, y);
+              return true;
+            case 0x3:
+              std::fprintf(out, "  V[%hhu] ^= V[%hhu];\n", x, y);
+              return true;
+            case 0x4:
+              std::fprintf(out, "  { uint8_t a = V[%hhu], b = V[%hhu]; V[0xF] = (0xFF - a) < b; V[%hhu] += b; }\n", x, y, x);
+              return true;
+            case 0x5:
+              std::fprintf(out, "  { uint8_t a = V[%hhu], b = V[%hhu]; V[0xF] = a > b; V[%hhu] -= b; }\n", x, y, x);
+              return true;
+            case 0x6:
+              if (quirk_profiles[this->quirks].shift_vy) {
+                std::fprintf(out, "  { uint8_t a = V[%hhu]; V[%hhu] = a >> 1; V[0xF] = a & 0x01; }\n", y, x);
+              } else {
+                std::fprintf(out, "  V[0xF] = V[%hhu] & 0x01; V[%hhu] >>= 1;\n", x, x);
+              }
+              return true;
+            case 0x7:
+              std::fprintf(out, "  { uint8_t a = V[%hhu], b = V[%hhu]; V[0xF] = a < b; V[%hhu] = b - a; }\n", x, y, x);
+              return true;
+            case 0xE:
+              if (quirk_profiles[this->quirks].shift_vy) {
+                std::fprintf(out, "  { uint8_t a = V[%hhu]; V[%hhu] = a << 1; V[0xF] = a >> 7; }\n", y, x);
+              } else {
+                std::fprintf(out, "  V[0xF] = V[%hhu] >> 7; V[%hhu] <<= 1;\n", x, x);
+              }
+              return true;
+          }
+          return true; // unknown, only advances the program counter
+        case 0xA:
+          std::fprintf(out, "  chip->index_register = 0x%.3X;\n", nnn);
+          return true;
+        case 0xC:
+          std::fprintf(out, "  V[%hhu] = (chip->nextRandom() %% 0xFF) & %hhu;\n", x, nn);
+          return true;
+        case 0xE:
+          return true; // unknown, only advances the program counter
+        case 0xF:
+          switch (opcode & 0x00FF) {
+            case 0x07:
+              std::fprintf(out, "  V[%hhu] = chip->delay_timer;\n", x);
+              return true;
+            case 0x15:
+              std::fprintf(out, "  chip->delay_timer = V[%hhu];\n", x);
+              return true;
+            case 0x18:
+              std::fprintf(out, "  chip->sound_timer = V[%hhu];\n", x);
+              return true;
+            case 0x1E:
+              if (quirk_profiles[this->quirks].index_overflow_flag) {
+                std::fprintf(out, "  { uint8_t a = V[%hhu]; V[0xF] = chip->index_register + a > 0xFFF; chip->index_register += a; }\n", x);
+              } else {
+                std::fprintf(out, "  chip->index_register += V[%hhu];\n", x);
+              }
+              return true;
+            case 0x29:
+              std::fprintf(out, "  chip->index_register = V[%hhu] * 0x5;\n", x);
+              return true;
+            case 0x65:
+              std::fprintf(out, "  for (int i = 0; i <= %hhu; i++) V[i] = chip->memory[chip->index_register + i];\n", x);
+              if (quirk_profiles[this->quirks].index_increment == INDEX_ADD_X) {
+                std::fprintf(out, "  chip->index_register += %hhu;\n", x);
+              } else if (quirk_profiles[this->quirks].index_increment == INDEX_ADD_X_PLUS_1) {
+                std::fprintf(out, "  chip->index_register += %d;\n", x + 1);
+              }
+              return true;
+          }
+          return true; // unknown, only advances the program counter
+      }
+      return false;
+    }
+    void writeSkipCondition(std::FILE *out, uint16_t opcode) {
+      uint8_t x = (opcode & 0x0F00) >> 8;
+      uint8_t y = (opcode & 0x00F0) >> 4;
+      uint8_t nn = opcode & 0x00FF;
+      switch (opcode >> 12) {
+        case 0x3:
+          std::fprintf(out, "  if (V[%hhu] == %hhu) {\n", x, nn);
+          break;
+        case 0x4:
+          std::fprintf(out, "  if (V[%hhu] != %hhu) {\n", x, nn);
+          break;
+        case 0x5:
+          std::fprintf(out, "  if (V[%hhu] == V[%hhu]) {\n", x, y);
+          break;
+        case 0x9:
+          std::fprintf(out, "  if (V[%hhu] != V[%hhu]) {\n", x, y);
+          break;
+        case 0xE:
+          if (nn == 0x9E) {
+            std::fprintf(out, "  if (chip->keyPressed(V[%hhu])) {\n", x);
+          } else {
+            std::fprintf(out, "  if (!chip->keyPressed(V[%hhu])) {\n", x);
+          }
+          break;
+      }
+    }
+    void writeBlock(std::FILE *out, uint16_t start) {
+      std::vector<uint16_t> successors;
+      int length = this->scanBlock(start, successors);
+      std::fprintf(out, "block_%.3X:\n", start);
+      if (this->timer_block[start]) {
+        // only entered from the switch, so no cycles have run yet
+        std::fprintf(out, "  if (%d > budget || %d > timer_window) return 0;\n", length, length);
+      } else {
+        std::fprintf(out, "  if (cycles + %d > budget) return cycles;\n", length);
+      }
+      std::fprintf(out, "  cycles += %d;\n", length);
+      uint16_t address = start;
+      for (int i = 0; i < length; i++, address += OPCODE_SIZE) {
+        uint16_t opcode = this->opcodeAt(address);
+        switch (flowOf(opcode)) {
+          case FLOW_NEXT:
+            if (!this->writeStatement(out, opcode)) {
+              this->writeInterpreted(out, address, opcode);
+            }
+            break;
+          case FLOW_JUMP:
+            if (this->isDelayLoop(address)) {
+              // the interpreter fast-forwards the wait
+              this->writeInterpreted(out, address, opcode);
+              std::fprintf(out, "  return cycles;\n");
+              return;
+            }
+            this->writeExit(out, opcode & 0x0FFF, "  ");
+            return;
+          case FLOW_SKIP:
+            this->writeSkipCondition(out, opcode);
+            this->writeExit(out, address + 2 * OPCODE_SIZE, "    ");
+            std::fprintf(out, "  }\n");
+            this->writeExit(out, address + OPCODE_SIZE, "  ");
+            return;
+          case FLOW_CALL:
+          case FLOW_STOP:
+          case FLOW_INDIRECT:
+            this->writeInterpreted(out, address, opcode);
+            std::fprintf(out, "  return cycles;\n");
+            return;
+        }
+      }
+      this->writeExit(out, address, "  ");
+    }
+  public:
+    Recompiler(std::string filename, int quirks) {
+      this->quirks = quirks;
+      std::memset(this->memory, 0, MEM_SIZE);
+      std::memset(this->block_start, 0, sizeof(this->block_start));
+      std::memset(this->timer_block, 0, sizeof(this->timer_block));
+      std::memset(this->coverage, 0, sizeof(this->coverage));
+      this->filename = filename;
+      std::FILE *file = std::fopen(filename.c_str(), "rb");
+      if (file == NULL) {
+        std::cout << "Couldn't open " << filename << "\n";
+        std::exit(0);
+      }
+      std::fseek(file, 0, SEEK_END);
+      this->rom_size = std::ftell(file);
+      std::fseek(file, 0, SEEK_SET);
+      if (this->rom_size > MEM_SIZE - PROGRAM_START - 1) {
+        std::fclose(file);
+        std::cout << "File is too big\n";
+        std::exit(0);
+      }
+      int bytes_read = std::fread(this->memory + PROGRAM_START, 1, this->rom_size, file);
+      std::fclose(file);
+      if (bytes_read != this->rom_size) {
+        std::cout << "Error reading file\n";
+        std::exit(0);
+      }
+    }
+    void recompile(std::string output_filename) {
+      this->findBlocks();
+      std::FILE *out = std::fopen(output_filename.c_str(), "w");
+      if (out == NULL) {
+        std::cout << "Couldn't create output file!\n";
+        std::exit(0);
+      }
+      std::fprintf(out, "// Generated by chip8rc from %s for the %s profile, do not edit\n", this->filename.c_str(),
+                   quirk_profiles[this->quirks].name);
+      std::fprintf(out, "#include \"CPU.h\"\n#include <cstdlib>\n\n");
+      std::fprintf(out, "static const uint8_t rom[] = {");
+      for (int i = 0; i < this->rom_size; i++) {
+        std::fprintf(out, "%s0x%.2X,", i % 16 == 0 ? "\n  " : " ", this->memory[PROGRAM_START + i]);
+      }
+      std::fprintf(out, "\n};\n\nstatic const uint8_t coverage[MEM_SIZE] = {");
+      for (int i = 0; i < MEM_SIZE; i++) {
+        std::fprintf(out, "%s%hhu,", i % 32 == 0 ? "\n  " : " ", this->coverage[i]);
+      }
+      std::fprintf(out, "\n};\n\n");
+      std::fprintf(out, "static uint32_t runBlock(Chip8 *chip, uint32_t budget, uint32_t timer_window) {\n");
+      std::fprintf(out, "  uint8_t *V = chip->registers;\n");
+      std::fprintf(out, "  uint32_t cycles = 0;\n");
+      std::fprintf(out, "  switch (chip->program_counter) {\n");
+      for (uint16_t start : this->blocks) {
+        std::fprintf(out, "    case 0x%.3X: goto block_%.3X;\n", start, start);
+      }
+      std::fprintf(out, "    default: return 0;\n  }\n");
+      for (uint16_t start : this->blocks) {
+        this->writeBlock(out, start);
+      }
+      std::fprintf(out, "}\n\n");
+      std::fprintf(out, "static const StaticProgram program = { rom, sizeof(rom), coverage, runBlock, %d };\n", this->quirks);
+      std::fprintf(out, "static bool registered = (registerStaticProgram(&program), true);\n");
+      std::fclose(out);
+      std::cout << "Translated " << this->blocks.size() << " blocks into " << output_filename << "\n";
+    }
+};
+
+int main(int argc, char **argv) {
+  std::string filename;
+  std::string output_filename;
+  int quirks = QUIRKS_MODERN;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      quirks = findQuirks(argv[++i]);
+      if (quirks < 0) {
+        std::cout << "Unknown quirk profile " << argv[i] << "\n";
+        std::exit(0);
+      }
+    } else if (filename.empty()) {
+      filename = argv[i];
+    } else {
+      output_filename = argv[i];
+    }
+  }
+  if (filename.empty()) {
+    std::cout << "Not enough arguments\n";
+    std::exit(0);
+  }
+  if (output_filename.empty()) {
+    output_filename = filename.substr(0, filename.rfind(".")) + ".cpp";
+  }
+  Recompiler(filename, quirks).recompile(output_filename);
+  return 0;
+}
\ No newline at end of file